@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "EngineCL.hpp"
+
+using std::cerr;
+using std::cout;
+using std::string;
+using std::vector;
+
+// CPU of 1e8 items/s and a GPU `ratio` times faster, with a PCIe-like bandwidth
+static vector<ecl::DeviceModel>
+models(size_t size, double ratio, double launchSeconds, double noise)
+{
+  ecl::DeviceModel cpu{ "cpu", 1e8, 20e-6, 0, 0.0, 0.0, 0.0, noise };
+  ecl::DeviceModel gpu{ "gpu", ratio * 1e8, launchSeconds, size * 8, 8e9, 4.0, 8e9, noise };
+  return { cpu, gpu };
+}
+
+static void
+printRow(const string& scheduler,
+         size_t chunks,
+         double ratio,
+         double launchSeconds,
+         double noise,
+         unsigned int seed,
+         const ecl::Stats& stats)
+{
+  cout << scheduler << "," << chunks << "," << ratio << "," << launchSeconds * 1e6 << ","
+       << noise << "," << seed << "," << stats.balance.makespan_ns / 1e6 << ","
+       << stats.balance.efficiency << "," << stats.balance.speedup << "\n";
+}
+
+/**
+ * Sweeps the static and dynamic schedulers over device ratios, launch latencies, noise and seeds
+ * in virtual time, as CSV.
+ */
+int
+main(int argc, char* argv[])
+{
+  if (argc < 3) {
+    cout << "usage:\n"
+         << "<size> <lws> [--seeds <n>]\n"
+         << "  eg: 1048576 128 --seeds 4\n";
+    return 1;
+  }
+  size_t size = std::stoul(argv[1]);
+  size_t lws = std::stoul(argv[2]);
+  unsigned int seeds = 1;
+  for (int i = 3; i < argc; ++i) {
+    string arg(argv[i]);
+    if (arg == "--seeds" && i + 1 < argc) {
+      seeds = std::stoul(argv[++i]);
+    }
+  }
+
+  vector<double> ratios = { 1, 2, 4, 8, 16, 32 };
+  vector<double> launches = { 5e-6, 50e-6, 500e-6 };
+  vector<double> noises = { 0.0, 0.05, 0.2 };
+  vector<size_t> chunkCounts = { 2, 4, 8, 16, 32, 64, 128, 256, 512 };
+
+  auto t1 = std::chrono::steady_clock::now();
+  size_t runs = 0;
+  cout << "scheduler,chunks,ratio,launch_us,noise,seed,makespan_ms,efficiency,speedup\n";
+  for (auto ratio : ratios) {
+    for (auto launch : launches) {
+      for (auto noise : noises) {
+        for (unsigned int seed = 0; seed < seeds; ++seed) {
+          ecl::Simulator sim(models(size, ratio, launch, noise), size, lws);
+          sim.setSeed(seed);
+
+          ecl::StaticScheduler even;
+          sim.setScheduler(&even);
+          printRow("static", 1, ratio, launch, noise, seed, sim.run());
+
+          auto cpu = 1.0f / (1.0f + static_cast<float>(ratio));
+          ecl::StaticScheduler proportional(ecl::StaticScheduler::WorkSplit::Raw);
+          sim.setScheduler(&proportional);
+          proportional.setRawProportions({ cpu });
+          printRow("static-raw", 1, ratio, launch, noise, seed, sim.run());
+          runs += 2;
+
+          for (auto chunks : chunkCounts) {
+            if (size / lws < chunks) {
+              continue;
+            }
+            ecl::DynamicScheduler dynamic;
+            sim.setScheduler(&dynamic);
+            dynamic.setChunks(chunks);
+            printRow("dynamic", chunks, ratio, launch, noise, seed, sim.run());
+            runs++;
+          }
+        }
+      }
+    }
+  }
+  auto t2 = std::chrono::steady_clock::now();
+  cerr << runs << " runs simulated in "
+       << std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count() << " ms\n";
+  return 0;
+}
@@ -2,19 +2,18 @@
 
 using namespace std::chrono;
 
-auto
-check_saxpy(vector<int> in1, vector<int> in2, vector<int> out, int size, float constant)
+// first wrong position, or -1 (the expected values are computed while comparing, not stored)
+int
+check_saxpy(const vector<int>& in1, const vector<int>& in2, const vector<int>& out, float constant)
 {
-  auto pos = -1;
-  for (auto i = 0; i < size; ++i) {
-    int v = (constant * (float)in1[i]) + in2[i];
-    if (v != out[i]) {
-      cout << "[" << i << "] = " << v << " != " << out[i] << "\n";
-      pos = i;
-      break;
-    }
+  auto expected = [&](size_t i) { return static_cast<int>((constant * (float)in1[i]) + in2[i]); };
+  auto comparison = ecl::parallelCompare(out, expected);
+  if (comparison.ok()) {
+    return -1;
   }
-  return pos;
+  auto pos = comparison.first;
+  cout << "[" << pos << "] = " << expected(pos) << " != " << out[pos] << "\n";
+  return static_cast<int>(pos);
 }
 
 void
@@ -118,11 +117,11 @@ saxpy(int argc, char* argv[])
   size_t lws = 128;
   size_t gws = size;
 
-  auto in1Array = make_shared<vector<int>>(size, 1);
-  auto in2Array = make_shared<vector<int>>(size, 2);
-  auto outArray = make_shared<vector<int>>(size, 0);
+  auto in1Array = make_shared<vector<int>>(size);
+  auto in2Array = make_shared<vector<int>>(size);
+  auto outArray = make_shared<vector<int>>(size);
 
-  auto timeInit = std::chrono::system_clock::now().time_since_epoch();
+  auto timeInit = std::chrono::steady_clock::now();
 
   ecl::StaticScheduler stSched;
   ecl::DynamicScheduler dynSched;
@@ -159,9 +158,15 @@ saxpy(int argc, char* argv[])
   runtime.setKernelArg(3, size);
   runtime.setKernelArg(4, constant);
 
+  // devices build the program while the host fills the input
+  runtime.prepare();
+
+  ecl::parallelFill(*in1Array, 1);
+  ecl::parallelFill(*in2Array, 2);
+
   runtime.run();
 
-  auto t2 = std::chrono::system_clock::now().time_since_epoch();
+  auto t2 = std::chrono::steady_clock::now();
   size_t diffMs = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - timeInit).count();
 
   cout << "time: " << diffMs << "\n";
@@ -169,11 +174,7 @@ saxpy(int argc, char* argv[])
   runtime.printStats();
 
   if (check) {
-    auto in1 = *in1Array.get();
-    auto in2 = *in2Array.get();
-    auto out = *outArray.get();
-
-    auto pos = check_saxpy(in1, in2, out, size, constant);
+    auto pos = check_saxpy(*in1Array, *in2Array, *outArray, constant);
     auto ok = pos == -1;
 
     if (ok) {
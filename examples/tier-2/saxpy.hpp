@@ -1,6 +1,7 @@
 #ifndef ENGINECL_EXAMPLES_SAXPY_HPP
 #define ENGINECL_EXAMPLES_SAXPY_HPP 1
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
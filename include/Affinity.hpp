@@ -0,0 +1,75 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#ifndef ENGINECL_AFFINITY_HPP
+#define ENGINECL_AFFINITY_HPP 1
+
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace ecl {
+
+//! \brief Parses a CPU list as in sysfs and `taskset -c` ("0-3,8,10-11").
+vector<int> parseCpuList(const string& list);
+//! \brief Sorted CPU list, with the consecutive CPUs as ranges.
+string formatCpuList(vector<int> cpus);
+
+//! \brief CPUs of the NUMA node (from sysfs). Throws if the node does not exist.
+vector<int> nodeCpus(int node);
+//! \brief CPUs the process is allowed to run on.
+vector<int> availableCpus();
+
+//! \brief Restricts the thread to `cpus` (all the available ones if empty). Throws on failure.
+void setThreadAffinity(std::thread& thread, const vector<int>& cpus);
+//! \brief As `setThreadAffinity`, for the calling thread.
+void setCurrentThreadAffinity(const vector<int>& cpus);
+//! \brief CPUs the thread is allowed to run on (empty if it is not running).
+vector<int> getThreadAffinity(std::thread& thread);
+vector<int> getCurrentThreadAffinity();
+
+/**
+ * \brief Placement of the host threads of a run (`Runtime::setAffinity`): the thread managing
+ * each device and the scheduler thread. The threads without CPUs float as before.
+ *
+ * With `setExcludeFromCpuDevices`, the OpenCL CPU devices are partitioned in a sub-device with as
+ * many compute units less as CPUs reserved for the threads, so the kernels leave them free to
+ * feed the other devices. OpenCL does not tell which cores a sub-device uses: the OS places them.
+ *
+ * ```cpp
+ * ecl::AffinityPolicy policy;
+ * policy.setScheduler({ 0 });
+ * policy.setDevice(1, ecl::nodeCpus(1)); // the GPU attached to the second socket
+ * runtime.setAffinity(policy);
+ * ```
+ */
+class AffinityPolicy
+{
+public:
+  AffinityPolicy();
+
+  void setScheduler(vector<int> cpus);
+  void setDevice(uint id, vector<int> cpus);
+  void setExcludeFromCpuDevices(bool exclude);
+
+  const vector<int>& getScheduler() const { return mScheduler; }
+  vector<int> getDevice(uint id) const;
+  bool getExcludeFromCpuDevices() const { return mExclude; }
+  //! \brief Every CPU a thread is pinned to, sorted.
+  vector<int> reservedCpus() const;
+
+private:
+  vector<int> mScheduler;
+  std::map<uint, vector<int>> mDevices;
+  bool mExclude;
+};
+
+} // namespace ecl
+
+#endif /* ENGINECL_AFFINITY_HPP */
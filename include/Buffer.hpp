@@ -59,6 +59,14 @@ public:
 
   size_t byBytes(size_t size);
 
+  //! \brief Transfer enqueued by the owner device (whole buffer or a chunk of it).
+  void addTransfer(size_t bytes);
+  //! \brief Device time of a transfer (START to END, only with event profiling).
+  void addTransferTime(size_t ns);
+  size_t transfers();
+  size_t transferredBytes();
+  size_t transferNs();
+
 private:
   Direction mDirection;
   size_t mItemSize;
@@ -66,6 +74,9 @@ private:
   size_t mBytes;
   void* mData;
   void* mAddress;
+  size_t mTransfers;
+  size_t mTransferredBytes;
+  size_t mTransferNs;
 };
 
 } // namespace ecl
@@ -0,0 +1,61 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#ifndef ENGINECL_CALIBRATION_HPP
+#define ENGINECL_CALIBRATION_HPP 1
+
+#include <cstddef>
+#include <vector>
+
+using std::vector;
+
+namespace ecl {
+
+/**
+ * \brief Measurements of a short probe of the kernel in a device.
+ *
+ * The writes transfer every input buffer (as a real run does), while the kernel and the reads
+ * only process `probeSize` work-items. `launchSeconds` is the time of a kernel of lws work-items.
+ */
+struct DeviceProfile
+{
+  int id;
+  unsigned int platform;
+  unsigned int device;
+  size_t probeSize;
+  size_t writeBytes;
+  double writeSeconds;
+  double launchSeconds;
+  double kernelSeconds;
+  size_t readBytes;
+  double readSeconds;
+
+  double writeBandwidth() const;
+  double readBandwidth() const;
+  double itemsPerSecond() const;
+
+  //! \brief Cost paid once per run (input transfer and kernel launch).
+  double fixedSeconds() const;
+  //! \brief Cost of each work-item (compute and read back).
+  double secondsPerItem() const;
+};
+
+struct Calibration
+{
+  vector<DeviceProfile> profiles;
+  //! \brief Ids of the selected devices, in the runtime order.
+  vector<int> devices;
+  //! \brief Proportions of the selected devices (valid for StaticScheduler::setRawProportions).
+  vector<float> proportions;
+  //! \brief Predicted time of the co-execution with the selected devices.
+  double makespan;
+};
+
+Calibration
+planDevices(const vector<DeviceProfile>& profiles, size_t size);
+
+} // namespace ecl
+
+#endif /* ENGINECL_CALIBRATION_HPP */
@@ -0,0 +1,76 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#ifndef ENGINECL_DECISIONLOG_HPP
+#define ENGINECL_DECISIONLOG_HPP 1
+
+#include <cstddef>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Scheduler.hpp"
+
+using std::string;
+using std::vector;
+
+namespace ecl {
+
+/**
+ * \brief Scheduling decisions of a run (`Runtime::saveDecisions` or `recordDecisions`), replayed
+ * by `ReplayScheduler`.
+ *
+ * Binary format: the magic `ECLDEC`, a version byte and LEB128 varints: the problem size, the
+ * number of records and, per record, the timestamp delta, device (shifted, with a lost bit),
+ * offset and size. A lost record drops the previous dispatch of its device and range, lost with
+ * the device (the work of the recovery is dispatched to a survivor).
+ */
+struct DecisionLog
+{
+  size_t size;
+  vector<Dispatch> dispatches;
+
+  void write(std::ostream& os) const;
+  void save(const string& path) const;
+  static DecisionLog read(std::istream& is);
+  static DecisionLog load(const string& path);
+};
+
+/**
+ * \brief Writes a `DecisionLog` while running (`Runtime::recordDecisions`): the records are
+ * appended as the scheduler takes the decisions, so the memory does not grow with the run.
+ *
+ * The number of records is written as a padded varint, completed by `close`. Not thread-safe:
+ * the schedulers append with their work locked.
+ */
+class DecisionWriter
+{
+public:
+  DecisionWriter(const string& path, size_t size);
+
+  DecisionWriter(DecisionWriter const&) = delete;
+  DecisionWriter& operator=(DecisionWriter const&) = delete;
+
+  void append(const Dispatch& dispatch);
+  //! \brief The range dispatched to `device` was lost with it (see `Recovery`).
+  void appendLost(int device, size_t offset, size_t size);
+  //! \brief Completes the number of records and closes the file, throwing on write errors.
+  void close();
+
+private:
+  void appendRecord(size_t ts_ns, int device, bool lost, size_t offset, size_t size);
+
+  string mPath;
+  std::ofstream mFile;
+  std::streampos mCountPos;
+  size_t mRecords;
+  size_t mPrevious; // timestamp of the previous record
+};
+
+} // namespace ecl
+
+#endif /* ENGINECL_DECISIONLOG_HPP */
@@ -8,8 +8,11 @@
 
 #include <CL/cl.hpp>
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <iostream>
+#include <mutex>
+#include <random>
 #include <string>
 #include <thread>
 #include <tuple>
@@ -19,7 +22,13 @@
 
 #include "Buffer.hpp"
 #include "CLUtils.hpp"
+#include "Calibration.hpp"
+#include "DeviceModel.hpp"
+#include "EventRing.hpp"
+#include "Launcher.hpp"
+#include "Metrics.hpp"
 #include "Semaphore.hpp"
+#include "ThreadPool.hpp"
 #include "config.hpp"
 
 using std::cout;
@@ -37,28 +46,84 @@ namespace ecl {
 enum class ActionType;
 class Scheduler;
 class Runtime;
+class Reactor;
 class Device;
 class Buffer;
 class NDRange;
+struct DeviceStats;
 
 #if ECL_SAVE_CHUNKS
 struct Chunk
 {
   size_t offset;
   size_t size;
-  size_t ts_ms;
-  size_t duration_ms;
+  size_t ts_ns;
+  size_t duration_ns;
+  size_t work; // works done before it, as `CommandProfile::chunk`
   Chunk() {}
-  Chunk(size_t _offset, size_t _size, size_t _ts_ms, size_t _duration_ms)
+  Chunk(size_t _offset, size_t _size, size_t _ts_ns, size_t _duration_ns, size_t _work)
   {
     offset = _offset;
     size = _size;
-    ts_ms = _ts_ms;
-    duration_ms = _duration_ms;
+    ts_ns = _ts_ns;
+    duration_ns = _duration_ns;
+    work = _work;
   }
 };
 #endif
 
+#if ECL_HANDOFF_PROFILING
+//! \brief Steps from a chunk completed in a device to the launch of its next chunk.
+enum class HandOffStep
+{
+  Completed = 0, // read back, callbackRead
+  Callback = 1,  // Scheduler::callback, after the chunk bookkeeping of the device
+  Wake = 2,      // the scheduler thread wakes up (notifyCallbacks)
+  Enqueued = 3,  // the next work is given (notifyWork)
+  Resumed = 4,   // the device thread wakes up (waitWork)
+  Launched = 5,  // enqueueNDRangeKernel
+};
+
+//! \brief Timestamps of the steps, in ns from the runtime init (0 if the step did not happen).
+struct HandOff
+{
+  size_t steps[6];
+};
+#endif
+
+//! \brief Data of the read back callback of a chunk (a preallocated slot of its device).
+struct CBData
+{
+  int queue_index;
+  Device* device;
+  std::atomic<bool> busy; // until the callback has read it
+#if ECL_SAVE_CHUNKS
+  Chunk chunk;  // started by the launching thread, saved by the callback
+  bool chunked; // false for works without items
+#endif
+};
+
+enum class CommandType
+{
+  Write = 0,
+  Kernel = 1,
+  Read = 2,
+};
+
+//! \brief OpenCL event profiling of a command, in ns of the device clock.
+struct CommandProfile
+{
+  CommandType type;
+  size_t enqueued; // host ns from the runtime init, when it was enqueued (QUEUED)
+  int chunk;       // works done before it (-1 for the input writes)
+  int buffer;      // index of the in (Write) or out (Read) buffer, -1 for the exit flag
+  size_t bytes;
+  cl_ulong queued;
+  cl_ulong submit;
+  cl_ulong start;
+  cl_ulong end;
+};
+
 void
 device_thread_func(Device& device);
 
@@ -74,6 +139,7 @@ enum class ArgType
   T = 0,
   Vector = 1,
   LocalAlloc = 2,
+  ExitFlag = 3,
 };
 
 class Device
@@ -118,12 +184,22 @@ public:
   void setKernel(const string& source, const string& kernel);
   void setID(int id);
   int getID();
+  uint getPlatformIndex() { return mSelPlatform; }
+  uint getDeviceIndex() { return mSelDevice; }
   void waitWork();
+  bool waitWork(std::chrono::nanoseconds timeout);
   void notifyWork();
 
   void printStats();
+  DeviceStats getStats();
+  const DeviceMetrics& getMetrics() { return *mMetrics; }
+
+  void quarantine(const string& reason);
+  bool isQuarantined();
+  const string& getFailure();
 
   void saveDuration(ActionType action);
+  void saveCallbackDuration(ActionType action);
   void saveDurationOffset(ActionType action);
 
   template<typename T>
@@ -152,6 +228,12 @@ public:
   void setKernelArg(cl_uint index, const uint bytes, ArgType type);
 
   void setKernelArgLocalAlloc(cl_uint index, const uint bytes);
+  void setKernelArgExitFlag(cl_uint index);
+  bool checkExit();
+  //! \brief Lowers the exit flag before a run.
+  void resetExit();
+  //! \brief Raises the exit flag of the host device computing the calling kernel (`HostDevice`).
+  static void raiseHostExit();
 
   void notifyEvent();
   void waitEvent();
@@ -159,47 +241,127 @@ public:
   void notifyRun();
   void waitRun();
 
+  void notifyData();
+  void waitData();
+  //! \brief Lets the thread leave before the data is given (a runtime prepared but not run).
+  void release();
+
   void setLWS(size_t lws);
 
-  void setTimeInit(std::chrono::duration<double> timeInit);
+  void setTimeInit(std::chrono::steady_clock::time_point timeInit);
+
+  void setProfiling(bool profiling);
+  void collectProfiling();
+
+  //! \brief CPUs of the host thread of the device (floats if empty), before `start`.
+  void setAffinity(vector<int> cpus);
+  //! \brief A CPU device computes in a sub-device of `count` compute units less.
+  void setReservedCpus(uint count);
+  /**
+   * \brief Computes the chunks with `kernel` in a pool of `threads` host threads, without OpenCL
+   * (see `HostDevice`).
+   *
+   * The host and simulated devices are plain `Device`s configured by these setters: every state
+   * they need lives in the `Device`, so `HostDevice` and `SimulatedDevice` add no members nor
+   * virtual methods and are sliced without loss when moved into the `vector<Device>` of a runtime.
+   */
+  void setHost(size_t threads);
+  bool isHost() { return mHost; }
+  void setHostKernel(ThreadPool::Task kernel);
+  //! \brief Waits the time of `model` for every chunk instead of computing it, sleeping or
+  //! spinning (see `SimulatedDevice`). Sliced as `setHost` explains.
+  void setSimulated(const DeviceModel& model, bool spin);
+  bool isSimulated() { return mSimulated; }
+  //! \brief The inputs are written from copies first touched by the thread of the device.
+  void setNodeLocalStaging(bool staging);
+  //! \brief CPUs the host thread may run on, once started.
+  const vector<int>& getPlacement() { return mPlacement; }
+  const vector<CommandProfile>& getCommandProfiles() { return mCommandProfiles; }
+  vector<tuple<size_t, ActionType>> getDurationOffsets()
+  {
+    return mDurationOffsetActions.toVector();
+  }
+#if ECL_SAVE_CHUNKS
+  vector<Chunk> getChunks() { return mChunks.toVector(); }
+#endif
 
 #if ECL_SAVE_CHUNKS
   void initChunk(size_t offset, size_t size);
-  void saveChunk();
+  void saveChunk(const Chunk& chunk);
+#endif
+
+#if ECL_HANDOFF_PROFILING
+  void markHandOff(HandOffStep step);
+  void markHandOff(HandOffStep step, size_t ns);
+  vector<HandOff> getHandOffs() { return mHandOffs.toVector(); }
 #endif
 
   uint getMinChunkMultiplier() { return mMinMultiplier; }
 
   // Thread API
+  void applyAffinity();
+  // stages of the thread of the device, or of the `Reactor` driving it
+  void initStage();
+  bool dataStage();
+  bool runStage();
+  bool workStep();
+
   void init();
+  void initData();
   void notifyBarrier();
   string& getBuffer();
   void showInfo();
 
   void doWork(size_t offset, size_t size, uint workitems, uint outPosition, int queueIndex);
+  void probe(size_t size, uint outWorkitems, uint outPositions);
+  DeviceProfile& getProfile() { return mProfile; }
 
   Runtime* getRuntime();
   void setRuntime(Runtime* runtime);
+  //! \brief Driven by the reactor (woken through it), without a thread of its own.
+  void setReactor(Reactor* reactor);
 
 private:
   void useRuntimeDiscovery();
   void initByIndex(uint selPlatform, uint selDevice);
+  void initSubDevice();
   void initContext();
   void initQueue();
   void initBuffers();
   void writeBuffers(bool dummy = false);
   void initKernel();
+  void initKernelArgs();
   void initEvents();
+  void enqueueProbeKernel(size_t size);
+  void initHost();
+  void doHostWork(size_t offset, size_t size, int queueIndex);
+  void probeHost(size_t size);
+  void simulate(size_t ns);
+  void simulateWrite();
+  void doSimulatedWork(size_t offset, size_t size, int queueIndex);
+  void probeSimulated(size_t size);
+  void saveSimulatedCommand(CommandType type, size_t start, size_t ns, size_t bytes);
+  void launchWork(size_t offset, size_t size, int queueIndex);
+  CBData* acquireCallbackSlot(int queueIndex);
+  void saveCommand(CommandType type, const cl::Event& event, int buffer = -1, size_t bytes = 0);
+  void saveTransfer(CommandType type, int buffer, size_t bytes);
+  void printProfiling();
+  void fillCommandTimes(DeviceStats& stats);
+  vector<tuple<size_t, ActionType>> getDurations();
 
   uint mSelPlatform;
   uint mSelDevice;
 
   Scheduler* mScheduler;
   Runtime* mRuntime;
+  Reactor* mReactor;
 
   shared_ptr<Semaphore> mBarrier;
 
   thread mThread;
+  vector<int> mCpus;
+  vector<int> mPlacement;
+  uint mReservedCpus;
   string mInfoBuffer;
 #pragma GCC diagnostic ignored "-Wignored-attributes"
   vector<cl_uint> mArgIndex;
@@ -216,6 +378,19 @@ private:
 
   vector<ecl::Buffer> mInEclBuffers;
   vector<ecl::Buffer> mOutEclBuffers;
+  bool mNodeLocalStaging;
+
+  bool mHost;
+  size_t mHostThreads;
+  ThreadPool::Task mHostKernel;
+  unique_ptr<ThreadPool> mPool;
+
+  bool mSimulated;
+  DeviceModel mModel;
+  bool mSpin;
+  std::mt19937 mRng;       // noise of the model
+  size_t mSimulatedDebtNs; // overslept, taken from the next wait
+  vector<unique_ptr<char[]>> mStagingBuffers; // one per input, reused by every write
 
   cl::Platform mPlatform;
   cl::Device mDevice;
@@ -226,18 +401,31 @@ private:
   string mKernelStr;
 
   vector<cl::Event> mPreviousEvents;
+  // reused by every chunk (see doWork)
+  vector<cl::Event> mKernelEvents;
+  cl::Event mFlagEvent;
+  cl::Event mReadEvent;
+  unique_ptr<CBData[]> mCallbackSlots;
+  size_t mCallbackSlot;
 
   int mId;
   Semaphore* mSemaWork;
   unique_ptr<Semaphore> mSemaRun;
+  unique_ptr<Semaphore> mSemaData;
 
   size_t mWorks;
   size_t mWorksSize;
-  mutex* mMutexDuration;
-  std::chrono::duration<double> mTimeInit;
-  std::chrono::duration<double> mTime;
-  vector<tuple<size_t, ActionType>> mDurationActions;
-  vector<tuple<size_t, ActionType>> mDurationOffsetActions;
+  size_t mWrites;
+  size_t mWriteBytes;
+  size_t mReads;
+  size_t mReadBytes;
+  unique_ptr<DeviceMetrics> mMetrics;
+  std::chrono::steady_clock::time_point mTimeInit;
+  std::chrono::steady_clock::time_point mTime; // start of the duration increments
+  // a ring per writer, in ns of the steady clock (merged by `getDurations`)
+  EventRing<tuple<size_t, ActionType>> mDurationActions; // the device thread
+  EventRing<tuple<size_t, ActionType>> mCallbackActions; // the completion callbacks
+  EventRing<tuple<size_t, ActionType>> mDurationOffsetActions;
 
   string mProgramSource;
   vector<char> mProgramBinary;
@@ -247,11 +435,35 @@ private:
 
   uint mMinMultiplier;
 
+  DeviceProfile mProfile;
+
+  unique_ptr<std::atomic<bool>> mQuarantined; // set by the OpenCL callbacks too (movable)
+  bool mReleased; // before the data, published by the semaphores
+  string mFailure;
+
+  bool mProfiling;
+  vector<tuple<CommandProfile, cl::Event>> mCommandEvents;
+  vector<CommandProfile> mCommandProfiles;
+
+  bool mHasExitFlag;
+  bool mExitRaised;
+  cl_int mExitFlag;
+  unique_ptr<std::atomic<bool>> mHostExit; // raised by the workers of the pool
+  ThreadPool::Task mHostTask;              // the host kernel, knowing its device
+  cl::Buffer mExitFlagBuffer;
+
 #if ECL_SAVE_CHUNKS
-  vector<Chunk> mChunks;
-  Chunk mChunk;
+  EventRing<Chunk> mChunks; // pushed by the callbacks
+  Chunk mChunk;             // the launching thread, copied into the callback slot
   bool mChunkUnsaved;
 #endif
+
+#if ECL_HANDOFF_PROFILING
+  EventRing<HandOff> mHandOffs;                       // pushed by the launching thread
+  unique_ptr<std::atomic<size_t>[]> mHandOffSteps; // marked by several threads (movable)
+#endif
+
+  unique_ptr<Launcher> mLauncher; // reactor mode, host and simulated (joined first)
 };
 
 } // namespace ecl
@@ -0,0 +1,54 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#ifndef ENGINECL_DEVICEMODEL_HPP
+#define ENGINECL_DEVICEMODEL_HPP 1
+
+#include <cstddef>
+#include <string>
+
+#include "Calibration.hpp"
+
+using std::string;
+
+namespace ecl {
+
+struct DeviceStats;
+
+/**
+ * \brief Cost model of a device: the input is written once before its first chunk, and every
+ * chunk pays the launch, the compute of its work-items and the read back of its output.
+ *
+ * A bandwidth of 0 does not model the transfers. `noise` is the relative standard deviation of
+ * the compute time of a chunk (0 is deterministic).
+ */
+struct DeviceModel
+{
+  string name;
+  double itemsPerSecond;
+  double launchSeconds;
+  size_t writeBytes;
+  double writeBandwidth; // bytes per second
+  double readBytesPerItem;
+  double readBandwidth;
+  double noise;
+
+  double fixedSeconds() const;
+  double secondsPerItem() const;
+  double writeSeconds() const;
+  double readSeconds(size_t items) const;
+
+  //! \brief Model of a calibration probe (`Runtime::calibrate`), without noise.
+  static DeviceModel fromProfile(const DeviceProfile& profile);
+  /**
+   * \brief Model fitted to the chunks of a recorded run (`Runtime::stats`): least squares of the
+   * chunk time over its size, separating the kernel and the transfers if it was profiled.
+   */
+  static DeviceModel fit(const DeviceStats& stats);
+};
+
+} // namespace ecl
+
+#endif /* ENGINECL_DEVICEMODEL_HPP */
@@ -7,13 +7,30 @@
 #ifndef ENGINECL_HPP
 #define ENGINECL_HPP 1
 
+#include "Affinity.hpp"
 #include "Buffer.hpp"
+#include "Calibration.hpp"
+#include "DecisionLog.hpp"
 #include "Device.hpp"
+#include "DeviceModel.hpp"
+#include "HostDevice.hpp"
+#include "HostOps.hpp"
+#include "Json.hpp"
+#include "Launcher.hpp"
+#include "Metrics.hpp"
 #include "NDRange.hpp"
+#include "Numa.hpp"
+#include "Reactor.hpp"
 #include "Runtime.hpp"
 #include "Scheduler.hpp"
+#include "SimulatedDevice.hpp"
+#include "Simulator.hpp"
+#include "Stats.hpp"
+#include "ThreadPool.hpp"
+#include "Trace.hpp"
 #include "config.hpp"
 #include "schedulers/Dynamic.hpp"
+#include "schedulers/Replay.hpp"
 //#include "schedulers/hguided.hpp"
 #include "schedulers/Static.hpp"
 
@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#ifndef ENGINECL_EVENTRING_HPP
+#define ENGINECL_EVENTRING_HPP 1
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace ecl {
+
+/**
+ * \brief Fixed-capacity ring of events with a single writer.
+ *
+ * The storage is allocated once, so `push` is wait-free (no lock nor allocation). When the ring
+ * is full the oldest events are overwritten (counted by `dropped`). It is read once the writer
+ * is done (eg. after the run): the events are indexed from the oldest kept.
+ *
+ * Owners with several writing threads keep a ring per writer (eg. a device and its completion
+ * callbacks) and merge them when reading; overlapping pushes are asserted in debug builds.
+ */
+template<typename T>
+class EventRing
+{
+public:
+  explicit EventRing(size_t capacity)
+    : mData(capacity)
+    , mHead(0)
+  {}
+
+  EventRing(const EventRing&) = delete;
+  EventRing& operator=(const EventRing&) = delete;
+
+  EventRing(EventRing&& other)
+    : mData(std::move(other.mData))
+    , mHead(other.mHead.load())
+  {}
+  EventRing& operator=(EventRing&& other)
+  {
+    mData = std::move(other.mData);
+    mHead = other.mHead.load();
+    return *this;
+  }
+
+  void push(const T& event)
+  {
+#ifndef NDEBUG
+    assert(!mWriting.exchange(true, std::memory_order_acquire) && "EventRing with two writers");
+#endif
+    auto head = mHead.load(std::memory_order_relaxed);
+    if (!mData.empty()) {
+      mData[head % mData.size()] = event;
+    }
+    mHead.store(head + 1, std::memory_order_release);
+#ifndef NDEBUG
+    mWriting.store(false, std::memory_order_release);
+#endif
+  }
+
+  size_t capacity() const { return mData.size(); }
+
+  size_t size() const
+  {
+    auto head = mHead.load(std::memory_order_acquire);
+    return head < mData.size() ? head : mData.size();
+  }
+
+  size_t dropped() const { return mHead.load(std::memory_order_acquire) - size(); }
+
+  const T& operator[](size_t index) const
+  {
+    return mData[(dropped() + index) % mData.size()];
+  }
+
+  std::vector<T> toVector() const
+  {
+    std::vector<T> events;
+    auto len = size();
+    events.reserve(len);
+    for (size_t i = 0; i < len; ++i) {
+      events.push_back((*this)[i]);
+    }
+    return events;
+  }
+
+  void clear() { mHead.store(0, std::memory_order_release); }
+
+private:
+  std::vector<T> mData;
+  std::atomic<size_t> mHead;
+#ifndef NDEBUG
+  std::atomic<bool> mWriting{ false };
+#endif
+};
+
+} // namespace ecl
+
+#endif /* ENGINECL_EVENTRING_HPP */
@@ -0,0 +1,48 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#ifndef ENGINECL_HOSTDEVICE_HPP
+#define ENGINECL_HOSTDEVICE_HPP 1
+
+#include <cstddef>
+
+#include "Device.hpp"
+
+namespace ecl {
+
+/**
+ * \brief Device computing its chunks in host threads with the C++ kernel of the runtime
+ * (`Runtime::setHostKernel`), writing straight into the arrays without transfers nor OpenCL.
+ *
+ * The schedulers treat it as any other device: it is meant to be sliced into the `vector<Device>`
+ * of the runtime (see `Device::setHost`). The kernel is called with (offset, size) ranges of a
+ * chunk, one per thread of its pool (`threads`, or by default the CPUs of the device thread less
+ * those reserved with `AffinityPolicy::setExcludeFromCpuDevices`).
+ *
+ * ```cpp
+ * devices.emplace_back(ecl::HostDevice());
+ * devices.emplace_back(ecl::Device(0, 0));
+ * ...
+ * runtime.setHostKernel([&](size_t offset, size_t size) {
+ *   for (auto i = offset; i < offset + size; ++i) { out[i] = a * x[i] + y[i]; }
+ * });
+ * ```
+ */
+class HostDevice : public Device
+{
+public:
+  explicit HostDevice(size_t threads = 0)
+    : Device(0, 0)
+  {
+    setHost(threads);
+  }
+
+  //! \brief From the host kernel: raises the exit flag (`Runtime::setKernelArgExitFlag`).
+  static void raiseExit() { raiseHostExit(); }
+};
+
+} // namespace ecl
+
+#endif /* ENGINECL_HOSTDEVICE_HPP */
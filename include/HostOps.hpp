@@ -0,0 +1,137 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#ifndef ENGINECL_HOSTOPS_HPP
+#define ENGINECL_HOSTOPS_HPP 1
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+using std::vector;
+
+namespace ecl {
+
+/**
+ * Host-side operations over whole arrays (initialization, staging copies and result checks),
+ * parallelized with OpenMP when the core is built with it and the array has at least
+ * `ECL_HOST_PARALLEL_BYTES`. `threads` limits the team (0: the OpenMP default); the threads of a
+ * team inherit the affinity of the caller, so a copy made by a pinned device thread stays in its
+ * node. They are compiled in the core (instantiated for int, uint, float and double), so they are
+ * parallel whatever flags the caller is built with.
+ */
+
+template<typename T>
+void parallelFill(T* data, size_t size, T value, int threads = 0);
+
+//! \brief `memcpy` of non-overlapping ranges, a contiguous block per thread.
+void parallelCopy(void* dst, const void* src, size_t bytes, int threads = 0);
+
+//! \brief Result of `parallelCompare`.
+struct Comparison
+{
+  size_t mismatches;
+  size_t first;    // index of the first mismatch (the size if none)
+  double maxError; // largest absolute difference (infinite if any is NaN)
+
+  bool ok() const { return mismatches == 0; }
+};
+
+/**
+ * \brief Compares `actual` with `expected` item by item. An item matches if the difference is at
+ * most `tolerance * max(1, |expected|)`: relative for large values and absolute near zero. The
+ * default (0) requires equality, as integers should; floats computed by other devices (FMA,
+ * reordered operations) need a tolerance as 1e-5.
+ */
+template<typename T>
+Comparison parallelCompare(const T* actual,
+                           const T* expected,
+                           size_t size,
+                           double tolerance = 0.0,
+                           int threads = 0);
+
+/**
+ * \brief Merges the comparisons of `compare(offset, size)` over blocks of [0, size), a block per
+ * thread (as `parallelCopy`, `bytes` decides it). The first of no mismatch is the size.
+ */
+Comparison parallelCompareRanges(size_t size,
+                                 size_t bytes,
+                                 const std::function<Comparison(size_t, size_t)>& compare,
+                                 int threads = 0);
+
+//! \brief Items [offset, offset + size) of `parallelCompare`, `expected(i)` giving the item `i`.
+template<typename T, typename Expected>
+Comparison
+compareRange(const T* actual, Expected& expected, size_t offset, size_t size, double tolerance)
+{
+  Comparison c = { 0, std::numeric_limits<size_t>::max(), 0.0 };
+  for (size_t i = offset; i < offset + size; ++i) {
+    double a = actual[i];
+    double e = expected(i);
+    double error = std::abs(a - e);
+    if (!(error <= tolerance * std::max(1.0, std::abs(e)))) { // NaN never matches
+      c.mismatches++;
+      c.first = std::min(c.first, i);
+      error = std::isnan(error) ? std::numeric_limits<double>::infinity() : error;
+    }
+    c.maxError = std::max(c.maxError, error);
+  }
+  return c;
+}
+
+template<typename T>
+void
+parallelFill(vector<T>& data, T value, int threads = 0)
+{
+  parallelFill(data.data(), data.size(), value, threads);
+}
+
+template<typename T>
+void
+parallelCopy(vector<T>& dst, const vector<T>& src, int threads = 0)
+{
+  static_assert(std::is_trivially_copyable<T>::value, "parallelCopy requires trivial items");
+  if (dst.size() != src.size()) {
+    throw std::runtime_error("parallelCopy of vectors of different sizes");
+  }
+  parallelCopy(dst.data(), src.data(), src.size() * sizeof(T), threads);
+}
+
+template<typename T>
+Comparison
+parallelCompare(const vector<T>& actual,
+                const vector<T>& expected,
+                double tolerance = 0.0,
+                int threads = 0)
+{
+  if (actual.size() != expected.size()) {
+    throw std::runtime_error("parallelCompare of vectors of different sizes");
+  }
+  return parallelCompare(actual.data(), expected.data(), actual.size(), tolerance, threads);
+}
+
+/**
+ * \brief As `parallelCompare`, with the expected items computed by `expected(i)` (called from
+ * several threads) instead of read from an array, so the reference is never stored.
+ */
+template<typename T, typename Expected>
+Comparison
+parallelCompare(const vector<T>& actual, Expected expected, double tolerance = 0.0, int threads = 0)
+{
+  auto data = actual.data();
+  auto compare = [&](size_t offset, size_t size) {
+    return compareRange(data, expected, offset, size, tolerance);
+  };
+  return parallelCompareRanges(actual.size(), actual.size() * sizeof(T), compare, threads);
+}
+
+} // namespace ecl
+
+#endif /* ENGINECL_HOSTOPS_HPP */
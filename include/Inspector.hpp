@@ -7,8 +7,14 @@
 #define ENGINECL_INSPECTOR_HPP 1
 
 #include <iostream>
+#include <string>
+#include <vector>
+
+#include "Scheduler.hpp"
 
 using std::cout;
+using std::string;
+using std::vector;
 
 namespace ecl {
 
@@ -32,12 +38,19 @@ enum class ActionType
 
   schedulerStart = 14,
   schedulerEnd = 15,
+
+  dataReady = 16,
 };
 
 class Inspector
 {
 public:
-  static void printActionTypeDuration(ActionType action, size_t d);
+  //! \brief Nanoseconds as milliseconds with 3 decimals.
+  static string toMs(size_t ns);
+  static void printDuration(const string& name, size_t ns);
+  static string actionTypeName(ActionType action);
+  static void printActionTypeDuration(ActionType action, size_t ns);
+  static void printRecoveries(const vector<Recovery>& recoveries);
 };
 
 } // namespace ecl
@@ -0,0 +1,22 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#ifndef ENGINECL_JSON_HPP
+#define ENGINECL_JSON_HPP 1
+
+#include <string>
+
+using std::string;
+
+namespace ecl {
+
+/**
+ * \brief JSON string literal of `str`, with the quotes, backslashes and control characters escaped.
+ */
+string jsonQuote(const string& str);
+
+} // namespace ecl
+
+#endif /* ENGINECL_JSON_HPP */
@@ -0,0 +1,64 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#ifndef ENGINECL_LAUNCHER_HPP
+#define ENGINECL_LAUNCHER_HPP 1
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <thread>
+
+#include "MPSCQueue.hpp"
+#include "Semaphore.hpp"
+
+using std::thread;
+
+namespace ecl {
+
+/**
+ * \brief Thread running the chunks of a host or simulated device in order, as the command queue
+ * of an OpenCL device, so the `Reactor` only launches them and the devices overlap.
+ *
+ * The chunks are (offset, size, queue index) records in a preallocated queue, so a launch does
+ * not allocate. It is created by the caller (inheriting its affinity).
+ */
+class Launcher
+{
+public:
+  //! \brief Computes the chunk (offset, size, queueIndex).
+  using Task = std::function<void(size_t, size_t, int)>;
+
+  //! \brief Up to `capacity` chunks queued (eg. ECL_DEVICE_PIPELINE).
+  Launcher(Task task, size_t capacity);
+  //! \brief Runs the chunks submitted and joins the thread.
+  ~Launcher();
+
+  Launcher(Launcher const&) = delete;
+  Launcher& operator=(Launcher const&) = delete;
+
+  //! \brief Queues the chunk, run after the previous ones (waits while the queue is full).
+  void submit(size_t offset, size_t size, int queueIndex);
+
+private:
+  struct Launch
+  {
+    size_t offset;
+    size_t size;
+    int queueIndex;
+  };
+
+  void run();
+
+  Task mTask;
+  MPSCQueue<Launch> mLaunches;
+  std::atomic<bool> mStop;
+  Semaphore mSema; // a notify per launch, and one more to leave
+  thread mThread;
+};
+
+} // namespace ecl
+
+#endif /* ENGINECL_LAUNCHER_HPP */
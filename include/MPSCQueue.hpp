@@ -0,0 +1,137 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#ifndef ENGINECL_MPSCQUEUE_HPP
+#define ENGINECL_MPSCQUEUE_HPP 1
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ecl {
+
+/**
+ * \brief Bounded lock-free queue of many producers and a single consumer (Vyukov).
+ *
+ * Every cell has a sequence number telling whether it is free for the producer of a position
+ * (`position`) or published for the consumer (`position + 1`). A producer claims a position with a
+ * CAS and publishes the value with a release store, so the consumer never reads a cell claimed but
+ * not written, nor a producer overwrites a value not consumed: `push` fails when the queue is full.
+ * The capacity is rounded up to a power of two, and the indices are in their own cache lines.
+ */
+template<typename T>
+class MPSCQueue
+{
+public:
+  explicit MPSCQueue(size_t capacity = 0)
+    : mCells(roundUp(capacity))
+    , mMask(mCells.size() - 1)
+    , mEnqueue(0)
+    , mDequeue(0)
+  {
+    for (size_t i = 0; i < mCells.size(); ++i) {
+      mCells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MPSCQueue(const MPSCQueue&) = delete;
+  MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+  //! \brief Not thread-safe (before the producers and the consumer start).
+  MPSCQueue(MPSCQueue&& other)
+    : mCells(std::move(other.mCells))
+    , mMask(other.mMask)
+    , mEnqueue(other.mEnqueue.load())
+    , mDequeue(other.mDequeue.load())
+  {}
+  MPSCQueue& operator=(MPSCQueue&& other)
+  {
+    mCells = std::move(other.mCells);
+    mMask = other.mMask;
+    mEnqueue = other.mEnqueue.load();
+    mDequeue = other.mDequeue.load();
+    return *this;
+  }
+
+  //! \brief Thread-safe. False if the queue is full.
+  bool push(const T& value)
+  {
+    auto pos = mEnqueue.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+      cell = &mCells[pos & mMask];
+      auto seq = cell->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (mEnqueue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false; // not consumed yet
+      } else {
+        pos = mEnqueue.load(std::memory_order_relaxed);
+      }
+    }
+    cell->value = value;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  //! \brief Consumer only. False if empty (or the next value is claimed but not published yet).
+  bool pop(T& value)
+  {
+    auto pos = mDequeue.load(std::memory_order_relaxed);
+    auto& cell = mCells[pos & mMask];
+    if (cell.sequence.load(std::memory_order_acquire) != pos + 1) {
+      return false;
+    }
+    value = cell.value;
+    cell.sequence.store(pos + mMask + 1, std::memory_order_release);
+    mDequeue.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t capacity() const { return mCells.size(); }
+
+  //! \brief Positions claimed by the producers (published or not).
+  size_t pushed() const { return mEnqueue.load(std::memory_order_acquire); }
+  size_t popped() const { return mDequeue.load(std::memory_order_acquire); }
+  //! \brief Approximate while producing (claimed and not consumed).
+  size_t size() const
+  {
+    auto popped = mDequeue.load(std::memory_order_acquire);
+    auto pushed = mEnqueue.load(std::memory_order_acquire);
+    return pushed > popped ? pushed - popped : 0;
+  }
+
+private:
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  static size_t roundUp(size_t capacity)
+  {
+    size_t size = 1;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    return size;
+  }
+
+  std::vector<Cell> mCells;
+  size_t mMask;
+  char mPadEnqueue[64];
+  std::atomic<size_t> mEnqueue; // producers
+  char mPadDequeue[64 - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> mDequeue; // consumer
+  char mPadEnd[64 - sizeof(std::atomic<size_t>)];
+};
+
+} // namespace ecl
+
+#endif /* ENGINECL_MPSCQUEUE_HPP */
@@ -0,0 +1,117 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#ifndef ENGINECL_METRICS_HPP
+#define ENGINECL_METRICS_HPP 1
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace ecl {
+class Runtime;
+
+/**
+ * \brief Counters of a device, written by its thread with relaxed atomics and read by the
+ * exporter thread (no locks in the device).
+ */
+struct DeviceMetrics
+{
+  std::atomic<size_t> chunks;
+  std::atomic<size_t> items;
+  std::atomic<size_t> writeBytes;
+  std::atomic<size_t> readBytes;
+  std::atomic<size_t> waitNs; // waiting for work from the scheduler
+
+  DeviceMetrics()
+    : chunks(0)
+    , items(0)
+    , writeBytes(0)
+    , readBytes(0)
+    , waitNs(0)
+  {}
+};
+
+struct DeviceCounters
+{
+  int id;
+  size_t chunks;
+  size_t items;
+  size_t writeBytes;
+  size_t readBytes;
+  size_t waitNs;
+};
+
+//! \brief Values of the counters of a runtime at a time (`Runtime::metrics`).
+struct MetricsSnapshot
+{
+  vector<DeviceCounters> devices;
+  size_t queueDepth;
+};
+
+/**
+ * \brief Writes the metrics of the runtimes periodically in the Prometheus text format.
+ *
+ * The target is a file, replaced atomically (written to `path.tmp` and renamed), or a Unix domain
+ * socket `unix:/path` answering every connection with the metrics (e.g. `curl --unix-socket`).
+ * The exporter outlives the runtimes: they are attached while running (see
+ * `Runtime::setMetricsExporter`) and their counters are accumulated per device id, so the counters
+ * only grow.
+ */
+class MetricsExporter
+{
+public:
+  MetricsExporter(const string& target,
+                  std::chrono::milliseconds period = std::chrono::milliseconds(1000));
+  ~MetricsExporter();
+
+  MetricsExporter(MetricsExporter const&) = delete;
+  MetricsExporter& operator=(MetricsExporter const&) = delete;
+
+  void attach(Runtime* runtime);
+  //! \brief Accumulates the last counters of the runtime, which can be destroyed afterwards.
+  void detach(Runtime* runtime);
+
+  //! \brief The metrics now, in the Prometheus text format.
+  string render();
+  //! \brief Renders and writes the metrics to the file (with a socket, they are served).
+  void publish();
+
+private:
+  void run();
+  void serve(int fd);
+  void writeFile(const string& text);
+
+  string mTarget;
+  string mSocketPath;
+  int mListenFd;
+  std::chrono::milliseconds mPeriod;
+
+  std::mutex mMutex;
+  vector<Runtime*> mRuntimes;
+  std::map<int, DeviceCounters> mDetached;
+  std::map<int, size_t> mLastItems;
+  std::chrono::steady_clock::time_point mLastRender;
+  size_t mRuns;
+  string mText;
+
+  std::mutex mMutexStop;
+  std::condition_variable mCondStop;
+  bool mStop;
+  std::thread mThread;
+};
+
+} // namespace ecl
+
+#endif /* ENGINECL_METRICS_HPP */
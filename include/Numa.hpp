@@ -0,0 +1,76 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#ifndef ENGINECL_NUMA_HPP
+#define ENGINECL_NUMA_HPP 1
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+using std::shared_ptr;
+using std::vector;
+
+namespace ecl {
+
+//! \brief Nodes with memory (1 without NUMA).
+vector<int> numaNodes();
+//! \brief Node of the CPU (0 without NUMA).
+int cpuNode(int cpu);
+//! \brief Node of every CPU, or -1 if they span many nodes (or there are none).
+int cpusNode(const vector<int>& cpus);
+
+/**
+ * \brief Where the pages of a host array live: bound to a node (the one closest to the device
+ * reading them) or interleaved page by page over nodes (every node if none is given).
+ */
+struct NumaPlacement
+{
+  enum class Policy
+  {
+    Default,
+    Bind,
+    Interleave,
+  };
+  Policy policy;
+  vector<int> nodes;
+
+  static NumaPlacement bind(int node) { return { Policy::Bind, { node } }; }
+  static NumaPlacement interleave(vector<int> nodes = {})
+  {
+    return { Policy::Interleave, std::move(nodes) };
+  }
+};
+
+/**
+ * \brief Applies the placement to the whole pages of the range with `mbind`: the pages not touched
+ * yet are allocated there, and the touched ones are migrated. Throws if the kernel refuses it
+ * (unknown node, or without NUMA support).
+ */
+void placeMemory(void* ptr, size_t bytes, const NumaPlacement& placement);
+
+/**
+ * \brief Vector of `size` items whose pages are placed before their first touch (the fill).
+ *
+ * ```cpp
+ * auto in = ecl::makeNumaVector<float>(n, ecl::NumaPlacement::bind(1), 1.0f);
+ * runtime.setInBuffer(in);
+ * ```
+ */
+template<typename T>
+shared_ptr<vector<T>>
+makeNumaVector(size_t size, const NumaPlacement& placement, const T& value = T())
+{
+  auto array = std::make_shared<vector<T>>();
+  array->reserve(size); // allocated, not touched
+  placeMemory(array->data(), size * sizeof(T), placement);
+  array->resize(size, value);
+  return array;
+}
+
+} // namespace ecl
+
+#endif /* ENGINECL_NUMA_HPP */
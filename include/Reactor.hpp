@@ -0,0 +1,64 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#ifndef ENGINECL_REACTOR_HPP
+#define ENGINECL_REACTOR_HPP 1
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "MPSCQueue.hpp"
+#include "Semaphore.hpp"
+
+using std::thread;
+using std::vector;
+
+namespace ecl {
+class Device;
+
+/**
+ * \brief Single thread driving every device of a runtime (`Runtime::setReactor`), instead of a
+ * thread per device.
+ *
+ * The devices go through the stages of their threads one after the other (so their warm up does
+ * not overlap). Then the wake ups of the scheduler (`Device::notifyWork`) arrive as device ids
+ * through a lock-free completion queue, and the reactor enqueues the next work of the device woken:
+ * the commands run asynchronously and their OpenCL callbacks reach the scheduler as usual, so N
+ * OpenCL devices need 2 host threads instead of N + 1. The reads are not blocking in this mode.
+ *
+ * Host and simulated devices still get a thread each (their `Launcher`), which computes or waits
+ * their chunks while the reactor only hands them over, so they overlap as in the default mode.
+ *
+ * The wake ups of a device are counted, and the device is queued only on the first one, so the
+ * queue never fills (the reactor thread may wake devices too, eg. from the scheduler).
+ */
+class Reactor
+{
+public:
+  explicit Reactor(vector<Device*> devices);
+  ~Reactor();
+
+  Reactor(Reactor const&) = delete;
+  Reactor& operator=(Reactor const&) = delete;
+
+  void start();
+  //! \brief Wakes the device `id`. Thread-safe.
+  void notify(int id);
+
+private:
+  void run();
+
+  vector<Device*> mDevices;
+  std::unique_ptr<std::atomic<uint>[]> mWakes; // pending per device
+  MPSCQueue<uint> mReady;                      // ids of the devices woken, once each
+  Semaphore mSemaReady;
+  thread mThread;
+};
+
+} // namespace ecl
+
+#endif /* ENGINECL_REACTOR_HPP */
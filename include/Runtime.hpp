@@ -10,10 +10,18 @@
 #include <memory>
 #include <mutex>
 
+#include "Affinity.hpp"
 #include "CLUtils.hpp"
+#include "Calibration.hpp"
+#include "DecisionLog.hpp"
 #include "Device.hpp"
+#include "EventRing.hpp"
+#include "Metrics.hpp"
 #include "NDRange.hpp"
+#include "Numa.hpp"
+#include "Reactor.hpp"
 #include "Semaphore.hpp"
+#include "Stats.hpp"
 
 using std::lock_guard;
 using std::make_shared;
@@ -26,10 +34,31 @@ using std::vector;
 namespace ecl {
 class Scheduler;
 
+//! \brief How a run ended (the ranges computed are given by `Runtime::getCompletedRanges`).
+enum class RunStatus
+{
+  Completed = 0,
+  Cancelled = 1,
+  DeadlineExceeded = 2,
+  EarlyExit = 3,
+};
+
 class Runtime
 {
 public:
-  void run();
+  void prepare();
+  RunStatus run();
+
+  void cancel();
+  void setDeadline(std::chrono::steady_clock::time_point deadline);
+  RunStatus getStatus();
+  vector<tuple<size_t, size_t>> getCompletedRanges();
+  tuple<size_t, size_t> getExitRange();
+  void exitFound(int queueIndex);
+
+  Calibration calibrate(size_t probeSize = 0);
+  bool isCalibrating();
+  void probe(Device& device);
 
   template<typename T>
   void setInBuffer(shared_ptr<vector<T>> array)
@@ -37,6 +66,7 @@ public:
     for (auto& device : mDevices) {
       device.setInBuffer(array);
     }
+    mArrays.push_back(make_tuple(array->data(), array->size() * sizeof(T)));
   }
   template<typename T>
   void setOutBuffer(shared_ptr<vector<T>> array)
@@ -44,9 +74,26 @@ public:
     for (auto& device : mDevices) {
       device.setOutBuffer(array);
     }
+    mArrays.push_back(make_tuple(array->data(), array->size() * sizeof(T)));
   }
+  //! \brief Registers the array placing its pages first (see `placeMemory`, `getDeviceNode`).
+  template<typename T>
+  void setInBuffer(shared_ptr<vector<T>> array, const NumaPlacement& placement)
+  {
+    placeMemory(array->data(), array->size() * sizeof(T), placement);
+    setInBuffer(array);
+  }
+  template<typename T>
+  void setOutBuffer(shared_ptr<vector<T>> array, const NumaPlacement& placement)
+  {
+    placeMemory(array->data(), array->size() * sizeof(T), placement);
+    setOutBuffer(array);
+  }
+  int getDeviceNode(uint id);
+  void setNodeLocalStaging(bool staging);
 
   void setKernel(const string& source, const string& kernel);
+  void setHostKernel(ThreadPool::Task kernel);
 
   template<typename T>
   void setKernelArg(cl_uint index, const T& value)
@@ -63,6 +110,10 @@ public:
     }
   }
   void setKernelArgLocalAlloc(cl_uint index, const uint bytes);
+  void setKernelArgExitFlag(cl_uint index);
+  void setProfiling(bool profiling);
+  void setAffinity(const AffinityPolicy& policy);
+  void setReactor(bool reactor);
 
   void discoverDevices();
 
@@ -73,6 +124,15 @@ public:
   cl::Device useDeviceDiscovery(uint selPlatform, uint selDevice);
 
   void printStats();
+  Stats stats();
+  void setBaseline(std::chrono::nanoseconds time);
+  void setBaseline(const Calibration& calibration);
+  void saveTrace(const string& path);
+  void saveDecisions(const string& path);
+  void recordDecisions(const string& path);
+
+  void setMetricsExporter(MetricsExporter* exporter);
+  MetricsSnapshot metrics();
 
   void notifyAllReady();
   void waitAllReady();
@@ -86,9 +146,11 @@ public:
           size_t lws = CL_LWS,
           uint out_workitems = 1,
           uint out_positions = 1);
+  ~Runtime();
 
 private:
   void configDevices();
+  void stop(RunStatus status);
 
   vector<cl::Platform> mPlatforms;
   vector<vector<cl::Device>> mPlatformDevices;
@@ -96,22 +158,41 @@ private:
   shared_ptr<Semaphore> mBarrier;
   vector<Device> mDevices;
   Scheduler* mScheduler;
+  AffinityPolicy mAffinity;
+  bool mReactorMode;
+  unique_ptr<Reactor> mReactor; // destroyed (joined) before the devices
 
   NDRange mGws;
   size_t mLws;
   uint mOutWorkitems;
   uint mOutPositions;
 
+  bool mPrepared;
+  bool mStarted; // the devices were given the data
+  mutex mMutexRun;
+  bool mRunning;
+  RunStatus mStatus;
+  bool mHasDeadline;
+  std::chrono::steady_clock::time_point mDeadline;
+  size_t mBaselineNs;
+  MetricsExporter* mMetrics;
+  unique_ptr<DecisionWriter> mDecisionWriter; // the next run (recordDecisions)
+  bool mHasExitRange;
+  tuple<size_t, size_t> mExitRange;
+  bool mCalibrating;
+  size_t mProbeSize;
+  vector<tuple<void*, size_t>> mArrays; // registered buffers, restored after the probes
+
   shared_ptr<Semaphore> mSemaReady;
   Semaphore mSemaAllReady;
 
-  mutex* mMutexDuration;
-  std::chrono::duration<double> mTimeInit;
-  std::chrono::duration<double> mTime;
-  vector<tuple<size_t, ActionType>> mDurationActions;
-  vector<tuple<size_t, ActionType>> mDurationOffsetActions;
+  std::chrono::steady_clock::time_point mTimeInit;
+  std::chrono::steady_clock::time_point mTime;
+  EventRing<tuple<size_t, ActionType>> mDurationActions;
+  EventRing<tuple<size_t, ActionType>> mDurationOffsetActions;
 
   string mKernel;
+  bool mHasHostKernel;
 };
 
 } // namespace ecl
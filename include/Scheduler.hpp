@@ -6,6 +6,7 @@
 #ifndef ENGINECL_SCHEDULER_HPP
 #define ENGINECL_SCHEDULER_HPP 1
 
+#include <chrono>
 #include <iostream>
 #include <mutex>
 #include <thread>
@@ -22,11 +23,34 @@ using std::vector;
 
 namespace ecl {
 class Device;
+class DecisionWriter;
+enum class ActionType;
+struct SchedulerStats;
+
+//! \brief Work of a failed device given to other device (`to` is -1 if no device survived).
+struct Recovery
+{
+  int from;
+  int to;
+  size_t offset;
+  size_t size;
+};
+
+//! \brief Work given to a device (ns from the runtime init).
+struct Dispatch
+{
+  size_t ts_ns;
+  int device;
+  size_t offset;
+  size_t size;
+};
 
 class Scheduler
 {
 public:
   virtual void start() = 0;
+  //! \brief CPUs of the scheduler thread (floats if empty), before `start`.
+  virtual void setAffinity(vector<int> cpus) = 0;
   virtual void calcProportions() = 0;
   virtual void waitCallbacks() = 0;
   virtual void setTotalSize(size_t size) = 0;
@@ -36,8 +60,43 @@ public:
   virtual Work getWork(uint queueIndex) = 0;
 
   virtual void printStats() = 0;
+  virtual SchedulerStats getStats() = 0;
+
+  virtual void setTimeInit(std::chrono::steady_clock::time_point timeInit) = 0;
+  //! \brief Decisions of the run; bounded schedulers keep only the latest ECL_EVENTS_CAPACITY.
+  virtual vector<Dispatch> getDispatches() = 0;
+  //! \brief Oldest decisions overwritten, missing from `getDispatches`.
+  virtual size_t getDispatchesDropped() = 0;
+  /**
+   * \brief Appends every decision to `writer` as it is taken (none if null), complete whatever
+   * the length of the run. Thread-safe.
+   */
+  virtual void setDecisionWriter(DecisionWriter* writer) = 0;
+  virtual vector<tuple<size_t, ActionType>> getDurationOffsets() = 0;
 
   virtual void callback(int queueIndex) = 0;
+  /**
+   * \brief The device failed and is quarantined: the work given to it (`queueIndex`, or -1 if
+   * it was not computing) is re-dispatched to the surviving devices and the device is released.
+   */
+  virtual void failWork(Device* device, int queueIndex) = 0;
+  /**
+   * \brief Stops giving work: the packages not started are dropped and the devices leave once
+   * their chunks in flight are completed. Thread-safe.
+   */
+  virtual void cancel() = 0;
+  /**
+   * \brief Chunks dispatched and not completed, plus the requests not served yet. Thread-safe and
+   * lock-free (read by the metrics exporter while running).
+   */
+  virtual size_t getQueueDepth() = 0;
+  /**
+   * \brief Requests and callbacks waiting for the scheduler thread (0 if they are served by the
+   * caller). Lock-free: the `Simulator` waits for 0 before advancing its virtual time.
+   */
+  virtual size_t getUnservedRequests() = 0;
+  //! \brief Completed (offset, size) ranges of the run, merged and sorted by offset.
+  virtual vector<tuple<size_t, size_t>> getCompletedRanges() = 0;
   virtual void requestWork(Device* device) = 0;
   virtual void enqueueWork(Device* device) = 0;
   virtual void preEnqueueWork() = 0;
@@ -6,10 +6,25 @@
 #ifndef ENGINECL_SEMAPHORE_HPP
 #define ENGINECL_SEMAPHORE_HPP 1
 
+#include <chrono>
 #include <condition_variable>
 #include <iostream>
 #include <mutex>
 
+#include "config.hpp"
+
+#if ECL_FUTEX_SEMAPHORE
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <ctime>
+#include <thread>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 /*!
  * Semaphore use cases:
  *
@@ -99,9 +114,9 @@ public:
   bool available();
   bool try_wait();
   template<class Rep, class Period>
-  bool wait_for(const std::chrono::duration<Rep, Period>& d);
+  bool wait_for(const std::chrono::duration<Rep, Period>& d, int count = 1);
   template<class Clock, class Duration>
-  bool wait_until(const std::chrono::time_point<Clock, Duration>& t);
+  bool wait_until(const std::chrono::time_point<Clock, Duration>& t, int count = 1);
 
   native_handle_type native_handle();
 
@@ -111,8 +126,6 @@ private:
   int mCount;
 };
 
-using Semaphore = basic_semaphore<std::mutex, std::condition_variable>;
-
 template<typename Mutex, typename CondVar>
 basic_semaphore<Mutex, CondVar>::basic_semaphore(int count)
   : mCount{ -count }
@@ -172,30 +185,37 @@ basic_semaphore<Mutex, CondVar>::available()
   return mCount > 0;
 }
 
+/*!
+  \brief as `wait`, giving up after `d`. Returns false (releasing nothing) on timeout.
+ */
 template<typename Mutex, typename CondVar>
 template<class Rep, class Period>
 bool
-basic_semaphore<Mutex, CondVar>::wait_for(const std::chrono::duration<Rep, Period>& d)
+basic_semaphore<Mutex, CondVar>::wait_for(const std::chrono::duration<Rep, Period>& d, int count)
 {
   std::unique_lock<Mutex> lock{ mMutex };
-  auto finished = mCv.wait_for(lock, d, [&] { return mCount > 0; });
+  auto finished = mCv.wait_for(lock, d, [&] { return mCount >= 0; });
 
   if (finished)
-    --mCount;
+    mCount -= count;
 
   return finished;
 }
 
+/*!
+  \brief as `wait`, giving up at `t`. Returns false (releasing nothing) on timeout.
+ */
 template<typename Mutex, typename CondVar>
 template<class Clock, class Duration>
 bool
-basic_semaphore<Mutex, CondVar>::wait_until(const std::chrono::time_point<Clock, Duration>& t)
+basic_semaphore<Mutex, CondVar>::wait_until(const std::chrono::time_point<Clock, Duration>& t,
+                                            int count)
 {
   std::unique_lock<Mutex> lock{ mMutex };
-  auto finished = mCv.wait_until(lock, t, [&] { return mCount > 0; });
+  auto finished = mCv.wait_until(lock, t, [&] { return mCount >= 0; });
 
   if (finished)
-    --mCount;
+    mCount -= count;
 
   return finished;
 }
@@ -207,4 +227,216 @@ basic_semaphore<Mutex, CondVar>::native_handle()
   return mCv.native_handle();
 }
 
+#if ECL_FUTEX_SEMAPHORE
+//! \brief Selects the futex `basic_semaphore` (as both template parameters).
+struct futex
+{};
+
+/*!
+ * \brief Semaphore on an atomic counter and a Linux futex, with the semantics of the generic one.
+ *
+ * `wait` spins a bounded number of times before parking in the kernel: the bound adapts, doubling
+ * when the spin acquires and halving when it parks (no spin with a single CPU). `notify` only
+ * enters the kernel when there are parked waiters. The state is padded to its own cache line.
+ */
+template<>
+class basic_semaphore<futex, futex>
+{
+public:
+  using native_handle_type = std::atomic<int>*;
+
+  explicit basic_semaphore(int count = 0);
+  basic_semaphore(const basic_semaphore&) = delete;
+  basic_semaphore(basic_semaphore&&) = delete;
+  basic_semaphore& operator=(const basic_semaphore&) = delete;
+  basic_semaphore& operator=(basic_semaphore&&) = delete;
+
+  void notify(int count = 1);
+  void wait(int count = 1);
+  bool available();
+  bool try_wait();
+  template<class Rep, class Period>
+  bool wait_for(const std::chrono::duration<Rep, Period>& d, int count = 1);
+  template<class Clock, class Duration>
+  bool wait_until(const std::chrono::time_point<Clock, Duration>& t, int count = 1);
+
+  native_handle_type native_handle();
+
+private:
+  static int spinMin();
+  static const int SPIN_MAX = 4096;
+
+  bool acquire(int count, int& observed);
+  bool spin(int count);
+  void park(int expected, const struct timespec* timeout);
+
+  char mPadBefore[64];
+  std::atomic<int> mCount; // the futex word
+  std::atomic<int> mWaiters;
+  std::atomic<int> mSpin;
+  char mPadAfter[64 - 3 * sizeof(std::atomic<int>)];
+};
+
+static_assert(sizeof(std::atomic<int>) == sizeof(int), "the futex word is an int");
+
+inline basic_semaphore<futex, futex>::basic_semaphore(int count)
+  : mCount{ -count }
+  , mWaiters{ 0 }
+  , mSpin{ spinMin() * 4 }
+{}
+
+inline int
+basic_semaphore<futex, futex>::spinMin()
+{
+  static const int min = std::thread::hardware_concurrency() > 1 ? 16 : 0;
+  return min;
+}
+
+//! \brief As `wait` without waiting: `observed` is the counter when it fails.
+inline bool
+basic_semaphore<futex, futex>::acquire(int count, int& observed)
+{
+  auto c = mCount.load(std::memory_order_acquire);
+  while (c >= 0) {
+    if (mCount.compare_exchange_weak(c, c - count, std::memory_order_acq_rel)) {
+      return true;
+    }
+  }
+  observed = c;
+  return false;
+}
+
+inline bool
+basic_semaphore<futex, futex>::spin(int count)
+{
+  auto limit = mSpin.load(std::memory_order_relaxed);
+  int max = SPIN_MAX;
+  int observed;
+  for (int i = 0; i < limit; ++i) {
+    if (acquire(count, observed)) {
+      mSpin.store(std::min(limit * 2, max), std::memory_order_relaxed);
+      return true;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+  }
+  mSpin.store(std::max(limit / 2, spinMin()), std::memory_order_relaxed);
+  return false;
+}
+
+/*!
+  \brief sleeps while the counter is `expected`. The waiter is counted before reading the counter
+  (both seq_cst), so a `notify` either sees the waiter or changes the counter before the sleep.
+ */
+inline void
+basic_semaphore<futex, futex>::park(int expected, const struct timespec* timeout)
+{
+  mWaiters.fetch_add(1);
+  if (mCount.load() == expected) {
+    syscall(SYS_futex,
+            reinterpret_cast<int*>(&mCount),
+            FUTEX_WAIT_PRIVATE,
+            expected,
+            timeout,
+            nullptr,
+            0);
+  }
+  mWaiters.fetch_sub(1);
+}
+
+inline void
+basic_semaphore<futex, futex>::notify(int count)
+{
+  mCount.fetch_add(count);
+  if (mWaiters.load() > 0) {
+    syscall(SYS_futex,
+            reinterpret_cast<int*>(&mCount),
+            FUTEX_WAKE_PRIVATE,
+            count > 1 ? INT_MAX : 1,
+            nullptr,
+            nullptr,
+            0);
+  }
+}
+
+inline void
+basic_semaphore<futex, futex>::wait(int count)
+{
+  if (spin(count)) {
+    return;
+  }
+  int observed;
+  while (!acquire(count, observed)) {
+    park(observed, nullptr);
+  }
+}
+
+inline bool
+basic_semaphore<futex, futex>::try_wait()
+{
+  auto c = mCount.load(std::memory_order_acquire);
+  while (c > 0) {
+    if (mCount.compare_exchange_weak(c, c - 1, std::memory_order_acq_rel)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+inline bool
+basic_semaphore<futex, futex>::available()
+{
+  return mCount.load(std::memory_order_acquire) > 0;
+}
+
+template<class Rep, class Period>
+bool
+basic_semaphore<futex, futex>::wait_for(const std::chrono::duration<Rep, Period>& d, int count)
+{
+  return wait_until(std::chrono::steady_clock::now() + d, count);
+}
+
+//! \brief A deadline already reached only tries once (no spin), as a poll.
+template<class Clock, class Duration>
+bool
+basic_semaphore<futex, futex>::wait_until(const std::chrono::time_point<Clock, Duration>& t,
+                                          int count)
+{
+  int observed;
+  if (acquire(count, observed)) {
+    return true;
+  }
+  if (Clock::now() >= t) {
+    return false;
+  }
+  if (spin(count)) {
+    return true;
+  }
+  while (!acquire(count, observed)) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t - Clock::now()).count();
+    if (ns <= 0) {
+      return false;
+    }
+    struct timespec timeout;
+    timeout.tv_sec = ns / 1000000000;
+    timeout.tv_nsec = ns % 1000000000;
+    park(observed, &timeout);
+  }
+  return true;
+}
+
+inline basic_semaphore<futex, futex>::native_handle_type
+basic_semaphore<futex, futex>::native_handle()
+{
+  return &mCount;
+}
+
+using Semaphore = basic_semaphore<futex, futex>;
+#else
+using Semaphore = basic_semaphore<std::mutex, std::condition_variable>;
+#endif
+
 #endif // ENGINECL_SEMAPHORE_HPP
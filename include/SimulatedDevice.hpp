@@ -0,0 +1,44 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#ifndef ENGINECL_SIMULATEDDEVICE_HPP
+#define ENGINECL_SIMULATEDDEVICE_HPP 1
+
+#include "Device.hpp"
+#include "DeviceModel.hpp"
+
+namespace ecl {
+
+/**
+ * \brief Device waiting in real time what its `DeviceModel` takes for each chunk, without OpenCL
+ * nor kernel: the input write before the first request, then the launch, compute and read back of
+ * every chunk. Unlike `Simulator` (virtual time), the runtime, its threads and the scheduler run
+ * as in production, so their overheads and contention are measured on machines without devices.
+ *
+ * By default it sleeps, and the time overslept is taken from its next chunk, so the speed ratios
+ * of the models hold over a run; `spin` busy-waits instead (exact per chunk, but a CPU per
+ * device). The output arrays are not written. Its constructor only sets up the base `Device`, which
+ * is what the `vector<Device>` of the runtime keeps once it is sliced (see `Device::setHost`). In
+ * reactor mode (`Runtime::setReactor`) every simulated device still waits in a thread of its own
+ * (its `Launcher`), so their chunks overlap.
+ *
+ * ```cpp
+ * devices.emplace_back(ecl::SimulatedDevice({ "cpu", 1e8, 20e-6, 0, 0.0, 0.0, 0.0, 0.0 }));
+ * devices.emplace_back(ecl::SimulatedDevice({ "gpu", 4e8, 50e-6, 0, 0.0, 0.0, 0.0, 0.0 }));
+ * ```
+ */
+class SimulatedDevice : public Device
+{
+public:
+  explicit SimulatedDevice(const DeviceModel& model, bool spin = false)
+    : Device(0, 0)
+  {
+    setSimulated(model, spin);
+  }
+};
+
+} // namespace ecl
+
+#endif /* ENGINECL_SIMULATEDDEVICE_HPP */
@@ -0,0 +1,80 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#ifndef ENGINECL_SIMULATOR_HPP
+#define ENGINECL_SIMULATOR_HPP 1
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Calibration.hpp"
+#include "Device.hpp"
+#include "DeviceModel.hpp"
+#include "Scheduler.hpp"
+#include "Stats.hpp"
+
+using std::string;
+using std::vector;
+
+namespace ecl {
+
+/**
+ * \brief Discrete-event simulator: drives a scheduler against modelled devices in virtual time.
+ *
+ * The scheduler is used as in a real run, but the devices are events in a single thread: a chunk
+ * given to a device completes at the virtual time of its model, and the virtual time advances once
+ * the scheduler has served every request. The stats (chunks, dispatches and balance) are in
+ * virtual ns, so thousands of configurations are evaluated in seconds without OpenCL devices.
+ *
+ * ```cpp
+ * ecl::Simulator sim({ cpu, gpu }, 1 << 20, 128);
+ * ecl::DynamicScheduler dyn;
+ * sim.setScheduler(&dyn);
+ * dyn.setChunks(64);
+ * auto stats = sim.run(); // stats.balance.makespan_ns
+ * ```
+ */
+class Simulator
+{
+public:
+  Simulator(vector<DeviceModel> models,
+            size_t gws,
+            size_t lws,
+            uint outWorkitems = 1,
+            uint outPositions = 1);
+
+  Simulator(Simulator const&) = delete;
+  Simulator& operator=(Simulator const&) = delete;
+
+  //! \brief A scheduler simulates a single run (set a new one for every run).
+  void setScheduler(Scheduler* scheduler);
+  void setSeed(unsigned int seed);
+  //! \brief Real time without progress after which the scheduler is considered deadlocked.
+  void setTimeout(std::chrono::milliseconds timeout);
+
+  Stats run();
+
+  //! \brief Time of the problem in the fastest device alone, without noise.
+  size_t baselineNs();
+
+private:
+  void waitServed();
+
+  vector<DeviceModel> mModels;
+  vector<Device> mDevices;
+  size_t mGws;
+  size_t mLws;
+  uint mOutWorkitems;
+  uint mOutPositions;
+  Scheduler* mScheduler;
+  unsigned int mSeed;
+  std::chrono::milliseconds mTimeout;
+};
+
+} // namespace ecl
+
+#endif /* ENGINECL_SIMULATOR_HPP */
@@ -0,0 +1,162 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#ifndef ENGINECL_STATS_HPP
+#define ENGINECL_STATS_HPP 1
+
+#include <cstddef>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "Scheduler.hpp"
+
+using std::string;
+using std::tuple;
+using std::vector;
+
+namespace ecl {
+enum class ActionType;
+
+//! \brief Action of a thread: `offset_ns` from the runtime init, `duration_ns` since the previous.
+struct PhaseStats
+{
+  string name;
+  size_t offset_ns;
+  size_t duration_ns;
+};
+
+struct ChunkStats
+{
+  size_t offset;
+  size_t size;
+  size_t ts_ns;
+  size_t duration_ns;
+  //! \brief Event profiling of the chunk: kernel and read back (0 without profiling).
+  size_t kernel_ns;
+  size_t transfer_ns;
+};
+
+//! \brief Transfers of a buffer of a device (`transfer_ns` and `gbps` need event profiling).
+struct BufferStats
+{
+  string direction; // in (host to device) or out (device to host)
+  size_t index;
+  size_t bytes;
+  size_t transfers;
+  size_t transferredBytes;
+  size_t transfer_ns;
+  double gbps;
+};
+
+struct DeviceStats
+{
+  int id;
+  unsigned int platform;
+  unsigned int device;
+  bool quarantined;
+  string failure;
+  bool host = false;      // `HostDevice`
+  bool simulated = false; // `SimulatedDevice`
+  vector<int> cpus;       // the host thread may run on (`Runtime::setAffinity`)
+  size_t works;
+  size_t worksSize;
+  //! \brief Oldest durations and chunks overwritten (see ECL_EVENTS_CAPACITY).
+  size_t eventsDropped;
+  vector<PhaseStats> phases;
+  vector<ChunkStats> chunks;
+  //! \brief Event profiling (0 without `Runtime::setProfiling`).
+  size_t kernel_ns;
+  size_t write_ns;
+  size_t read_ns;
+  size_t overhead_ns;
+  //! \brief Transfers: writes are host to device, reads device to host (exit flag included).
+  size_t writes;
+  size_t writeBytes;
+  size_t reads;
+  size_t readBytes;
+  double write_gbps; // effective, from write_ns and read_ns
+  double read_gbps;
+  vector<BufferStats> buffers;
+  //! \brief Balance (from the chunks): time computing, waiting between chunks and finishing.
+  size_t busy_ns = 0;
+  size_t idle_ns = 0;
+  size_t finish_ns = 0; // from the start of the first chunk of the run
+  size_t lag_ns = 0;    // to the last device finishing
+};
+
+struct BalanceStats
+{
+  //! \brief From the start of the first chunk to the end of the last one.
+  size_t makespan_ns = 0;
+  //! \brief First device finishing / last device finishing (1.0 is a perfect balance).
+  double efficiency = 0.0;
+  //! \brief Time of the fastest device alone, given (`Runtime::setBaseline`) or measured.
+  size_t baseline_ns = 0;
+  //! \brief Measured: the busy time of each device scaled to the whole problem (the minimum).
+  bool baselineMeasured = false;
+  double speedup = 0.0;
+};
+
+//! \brief Distribution of a latency (nearest-rank percentiles).
+struct LatencyStats
+{
+  string name;
+  size_t samples;
+  size_t p50_ns;
+  size_t p99_ns;
+  size_t max_ns;
+};
+
+struct SchedulerStats
+{
+  string name;
+  size_t chunks;
+  vector<int> cpus;
+  vector<PhaseStats> phases;
+  vector<Dispatch> dispatches;
+  vector<Recovery> recoveries;
+  //! \brief Steps from a chunk completed to the next launched in the device, and the whole `gap`
+  //! (see ECL_HANDOFF_PROFILING).
+  vector<LatencyStats> handoff;
+};
+
+/**
+ * \brief Statistics of a run (`Runtime::stats`), the data shown by `printStats`.
+ */
+struct Stats
+{
+  string kernel;
+  string status;
+  vector<PhaseStats> phases;
+  vector<DeviceStats> devices;
+  SchedulerStats scheduler;
+  BalanceStats balance;
+  vector<tuple<size_t, size_t>> completed;
+
+  string toJson() const;
+  /**
+   * \brief One row per phase, chunk and dispatch:
+   * `thread,kind,name,offset,size,ts_ns,duration_ns` (thread is runtime, scheduler or device id).
+   */
+  string toCsv() const;
+};
+
+vector<PhaseStats>
+phasesFromOffsets(const vector<tuple<size_t, ActionType>>& offsets);
+
+/**
+ * \brief Fills the balance of the devices and the run from their chunks. A `baselineNs` of 0
+ * measures the baseline from the chunks.
+ */
+void
+computeBalance(Stats& stats, size_t baselineNs);
+
+LatencyStats
+latencyStats(const string& name, vector<size_t> samples);
+
+} // namespace ecl
+
+#endif /* ENGINECL_STATS_HPP */
@@ -0,0 +1,68 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#ifndef ENGINECL_THREADPOOL_HPP
+#define ENGINECL_THREADPOOL_HPP 1
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "Semaphore.hpp"
+
+using std::thread;
+using std::unique_ptr;
+using std::vector;
+
+namespace ecl {
+
+/**
+ * \brief Fixed threads computing the parts of a range (`HostDevice`). The caller computes the
+ * first part, so a pool of N threads has N - 1 workers, created by the caller (inheriting its
+ * affinity).
+ */
+class ThreadPool
+{
+public:
+  using Task = std::function<void(size_t offset, size_t size)>;
+
+  explicit ThreadPool(size_t threads);
+  ~ThreadPool();
+
+  ThreadPool(ThreadPool const&) = delete;
+  ThreadPool& operator=(ThreadPool const&) = delete;
+
+  size_t size() const { return mWorkers.size() + 1; }
+
+  /**
+   * \brief Runs `task` over [offset, offset + size) split in a contiguous part per thread (multiple
+   * of `granularity`, but the last), returning once every part is done. Rethrows the first
+   * exception of a part.
+   */
+  void parallelFor(size_t offset, size_t size, size_t granularity, const Task& task);
+
+private:
+  void work(size_t index);
+  void runPart(size_t index);
+
+  vector<thread> mWorkers;
+  vector<unique_ptr<Semaphore>> mSemaStart; // per worker
+  Semaphore mSemaDone;
+  const Task* mTask;
+  size_t mOffset;
+  size_t mSize;
+  size_t mPart;
+  std::atomic<bool> mExit;
+  std::exception_ptr mError;
+  std::atomic_flag mErrorLock;
+};
+
+} // namespace ecl
+
+#endif /* ENGINECL_THREADPOOL_HPP */
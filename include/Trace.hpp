@@ -0,0 +1,50 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#ifndef ENGINECL_TRACE_HPP
+#define ENGINECL_TRACE_HPP 1
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace ecl {
+
+/**
+ * \brief Timeline in the Chrome Trace Event format (chrome://tracing, ui.perfetto.dev).
+ *
+ * Every track is a thread of the runtime. Timestamps are nanoseconds from the runtime init.
+ * Names and categories are escaped, while `args` are already formatted JSON members.
+ */
+class Trace
+{
+public:
+  void setTrackName(int track, const string& name);
+  void addSpan(int track,
+               const string& name,
+               const string& category,
+               size_t tsNs,
+               size_t durationNs,
+               const string& args = "");
+  void addInstant(int track,
+                  const string& name,
+                  const string& category,
+                  size_t tsNs,
+                  const string& args = "");
+
+  void write(std::ostream& os) const;
+  void save(const string& path) const;
+
+private:
+  vector<string> mEvents;
+};
+
+} // namespace ecl
+
+#endif /* ENGINECL_TRACE_HPP */
@@ -6,10 +6,15 @@
 #ifndef ENGINECL_WORK_HPP
 #define ENGINECL_WORK_HPP 1
 
+#include <algorithm>
 #include <string>
+#include <tuple>
+#include <vector>
 
 using std::runtime_error;
 using std::to_string;
+using std::tuple;
+using std::vector;
 
 class Work
 {
@@ -53,4 +58,52 @@ splitWorkLikeHGuided(size_t total, size_t minWorksize, size_t lws, float compute
   return ret;
 }
 
+/**
+ * \brief Sorts the (offset, size) ranges and joins the contiguous ones.
+ */
+inline vector<tuple<size_t, size_t>>
+mergeRanges(vector<tuple<size_t, size_t>> ranges)
+{
+  std::sort(ranges.begin(), ranges.end());
+  vector<tuple<size_t, size_t>> merged;
+  for (auto& range : ranges) {
+    size_t offset, size;
+    std::tie(offset, size) = range;
+    if (!merged.empty()) {
+      auto& last = merged.back();
+      auto end = std::get<0>(last) + std::get<1>(last);
+      if (offset <= end) {
+        std::get<1>(last) = std::max(end, offset + size) - std::get<0>(last);
+        continue;
+      }
+    }
+    merged.push_back(range);
+  }
+  return merged;
+}
+
+/**
+ * \brief Inserts the (offset, size) range in the sorted and merged `ranges`, joining it with its
+ * contiguous neighbours, so the ranges stay as few as the holes between them.
+ */
+inline void
+insertRange(vector<tuple<size_t, size_t>>& ranges, size_t offset, size_t size)
+{
+  auto it = std::lower_bound(ranges.begin(), ranges.end(), std::make_tuple(offset, size_t(0)));
+  if (it != ranges.begin() && offset <= std::get<0>(*(it - 1)) + std::get<1>(*(it - 1))) {
+    --it;
+  } else {
+    it = ranges.insert(it, std::make_tuple(offset, size));
+  }
+  auto begin = std::get<0>(*it);
+  auto end = std::max(begin + std::get<1>(*it), offset + size);
+  auto last = it + 1;
+  while (last != ranges.end() && std::get<0>(*last) <= end) {
+    end = std::max(end, std::get<0>(*last) + std::get<1>(*last));
+    ++last;
+  }
+  std::get<1>(*it) = end - begin;
+  ranges.erase(it + 1, last);
+}
+
 #endif // ENGINECL_WORK_HPP
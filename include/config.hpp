@@ -12,6 +12,7 @@
 // #define ECL_LOGGING 1
 // #define ECL_RUNTIME_WAIT_ALL_READY 1
 #define ECL_SAVE_CHUNKS 1
+// #define ECL_HANDOFF_PROFILING 1
 
 /* CONFIGURATION End */
 
@@ -51,4 +52,33 @@
 #define ECL_SAVE_CHUNKS 0
 #endif // ECL_SAVE_CHUNKS
 
+// timestamps of the hand-off between a chunk completed and the next launched in its device
+#ifndef ECL_HANDOFF_PROFILING
+#define ECL_HANDOFF_PROFILING 0
+#endif // ECL_HANDOFF_PROFILING
+
+// futex semaphores (Linux), spinning before parking; otherwise mutex and condition variable
+#ifndef ECL_FUTEX_SEMAPHORE
+#ifdef __linux__
+#define ECL_FUTEX_SEMAPHORE 1
+#else
+#define ECL_FUTEX_SEMAPHORE 0
+#endif
+#endif // ECL_FUTEX_SEMAPHORE
+
+// chunks of a device whose read back may be pending (callback slots, see Device::doWork)
+#ifndef ECL_DEVICE_PIPELINE
+#define ECL_DEVICE_PIPELINE 4
+#endif // ECL_DEVICE_PIPELINE
+
+// events kept per device (durations and chunks), the oldest are overwritten when full
+#ifndef ECL_EVENTS_CAPACITY
+#define ECL_EVENTS_CAPACITY 65536
+#endif // ECL_EVENTS_CAPACITY
+
+// smallest array (bytes) filled, copied or compared by an OpenMP team (see HostOps.hpp)
+#ifndef ECL_HOST_PARALLEL_BYTES
+#define ECL_HOST_PARALLEL_BYTES (1 << 20)
+#endif // ECL_HOST_PARALLEL_BYTES
+
 #endif /* ENGINECL_CONFIG_HPP */
@@ -14,7 +14,9 @@
 #include <thread>
 #include <vector>
 
+#include "EventRing.hpp"
 #include "Inspector.hpp"
+#include "MPSCQueue.hpp"
 #include "Scheduler.hpp"
 #include "Semaphore.hpp"
 #include "Work.hpp"
@@ -57,13 +59,16 @@ public:
 
   // Public API
   void start() override;
+  void setAffinity(vector<int> cpus) override { mCpus = move(cpus); }
 
   void setChunks(size_t chunks);
   void setWorkSize(size_t size);
 
   bool hasWork();
+  void enqueueIdleWork();
 
   Device* getNextRequest();
+  void servedRequest();
 
   void notifyDevices();
 
@@ -86,11 +91,31 @@ public:
   void init();
 
   void printStats() override;
+  SchedulerStats getStats() override;
+
+  void setTimeInit(std::chrono::steady_clock::time_point timeInit) override;
+  vector<Dispatch> getDispatches() override;
+  size_t getDispatchesDropped() override;
+  void setDecisionWriter(DecisionWriter* writer) override;
+  vector<tuple<size_t, ActionType>> getDurationOffsets() override
+  {
+    return mDurationOffsetActions.toVector();
+  }
 
   void saveDuration(ActionType action);
   void saveDurationOffset(ActionType action);
+  //! \brief Called by the scheduler thread before any work, then releases `start`.
+  void applyAffinity();
+#if ECL_HANDOFF_PROFILING
+  void markWake();
+#endif
 
   void callback(int queueIndex) override;
+  void failWork(Device* device, int queueIndex) override;
+  void cancel() override;
+  size_t getQueueDepth() override;
+  size_t getUnservedRequests() override;
+  vector<tuple<size_t, size_t>> getCompletedRanges() override;
   void requestWork(Device* device) override;
   void enqueueWork(Device* device) override;
   void preEnqueueWork() override;
@@ -100,18 +125,38 @@ public:
   void setOutPattern(uint outWorkitems, uint outPositions) override;
 
 private:
+  void saveDispatch(int device, size_t offset, size_t size);
+  void saveRecovery(const Recovery& recovery);
+  void pushRequest(uint id);
+  uint slotIndex(uint id, uint chunk) const;
+  void claimSlot(uint index);
+  void releaseSlot(uint index);
+
   thread mThread;
+  vector<int> mCpus;
+  vector<int> mPlacement; // of mThread
+  Semaphore mSemaPinned;  // applyAffinity done
+  string mAffinityError;  // thrown by start
   size_t mSize;
   vector<Device*> mDevices;
   uint mNumDevices;
   mutex mMutexWork;
-  vector<Work> mQueueWork;
-  vector<vector<uint>> mQueueIdWork;
-  uint mQueueWorkSizes;
+  vector<Work> mSlots; // in-flight work, ECL_DEVICE_PIPELINE per device (the queue indices)
+  vector<atomic<bool>> mSlotsBusy; // debug builds check that in-flight slots are not reused
   vector<uint> mChunkTodo;
   vector<uint> mChunkGiven;
   vector<uint> mChunkDone;
-  uint mDevicesWorking;
+  vector<bool> mFailed;
+  atomic<uint> mDevicesAlive;
+  vector<Work> mRetries;
+  vector<Device*> mIdleDevices;
+  vector<Recovery> mRecovered;
+  EventRing<Dispatch> mDispatches;  // the latest, for the stats
+  DecisionWriter* mDecisionWriter; // every one, while recording
+  mutex mMutexCompleted;
+  vector<tuple<size_t, size_t>> mCompleted; // merged, so bounded by the chunks in flight
+  atomic<bool> mCancelled;
+  atomic<uint> mChunksInFlight;
   vector<tuple<size_t, size_t>> mProportions;
   vector<float> mRawProportions;
 
@@ -121,10 +166,8 @@ private:
   Semaphore mSemaCallbacks;
   queue<int> mRequests;
   atomic<size_t> mChunksDone;
-  int mRequestsMax;
-  atomic<uint> mRequestsIdx;
-  atomic<uint> mRequestsIdxDone;
-  vector<uint> mRequestsList;
+  MPSCQueue<uint> mRequestsQueue; // ids of the devices, pushed by requestWork and callback
+  atomic<size_t> mRequestsServed; // after their enqueueWork
 
   size_t mSizeRemaining;
   size_t mSizeRemainingGiven;
@@ -138,11 +181,13 @@ private:
   uint mOutWorkitems;
   uint mOutPositions;
 
-  mutex* mMutexDuration;
-  std::chrono::duration<double> mTimeInit;
-  std::chrono::duration<double> mTime;
-  vector<tuple<size_t, ActionType>> mDurationActions;
-  vector<tuple<size_t, ActionType>> mDurationOffsetActions;
+  std::chrono::steady_clock::time_point mTimeInit;
+  std::chrono::steady_clock::time_point mTime;
+  EventRing<tuple<size_t, ActionType>> mDurationActions;
+  EventRing<tuple<size_t, ActionType>> mDurationOffsetActions;
+#if ECL_HANDOFF_PROFILING
+  size_t mWakeNs; // last wake up of the scheduler thread, from the runtime init
+#endif
 };
 
 } // namespace ecl
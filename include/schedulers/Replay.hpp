@@ -0,0 +1,53 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#ifndef ENGINECL_SCHEDULER_REPLAY_HPP
+#define ENGINECL_SCHEDULER_REPLAY_HPP 1
+
+#include <vector>
+
+#include "DecisionLog.hpp"
+#include "schedulers/Static.hpp"
+
+namespace ecl {
+
+/**
+ * \brief Gives every device the chunks of a recorded run (`DecisionLog`), in the recorded order.
+ *
+ * The assignment does not depend on the timing of the devices, so runs are comparable. It is a
+ * static scheduler queueing the recorded chunks instead of a package per device, so the work of
+ * a failing device goes to the survivor with less pending chunks.
+ */
+class ReplayScheduler : public StaticScheduler
+{
+public:
+  ReplayScheduler(const DecisionLog& log);
+
+  ReplayScheduler(ReplayScheduler const&) = delete;
+  ReplayScheduler& operator=(ReplayScheduler const&) = delete;
+
+  void setTotalSize(size_t size) override;
+  void setDevices(vector<Device*>&& devices) override;
+
+  int getWorkIndex(Device* device) override;
+
+  void printStats() override;
+  SchedulerStats getStats() override;
+
+  void requestWork(Device* device) override;
+  void enqueueWork(Device* device) override;
+  void preEnqueueWork() override;
+
+protected:
+  void notifyRecovered(int to, const Work& work) override;
+
+private:
+  DecisionLog mLog;
+  vector<bool> mRequested;
+};
+
+} // namespace ecl
+
+#endif /* ENGINECL_SCHEDULER_REPLAY_HPP */
@@ -6,17 +6,20 @@
 #ifndef ENGINECL_SCHEDULER_STATIC_HPP
 #define ENGINECL_SCHEDULER_STATIC_HPP 1
 
+#include <atomic>
 #include <iostream>
 #include <mutex>
 #include <thread>
 #include <tuple>
 #include <vector>
 
+#include "EventRing.hpp"
 #include "Inspector.hpp"
 #include "Scheduler.hpp"
 #include "Semaphore.hpp"
 #include "Work.hpp"
 
+using std::atomic;
 using std::lock_guard;
 using std::make_tuple;
 using std::mutex;
@@ -47,6 +50,7 @@ public:
 
   // Public API
   void start() override;
+  void setAffinity(vector<int> cpus) override { mCpus = move(cpus); }
 
   StaticScheduler(WorkSplit wsplit = WorkSplit::By_Devices);
 
@@ -71,11 +75,28 @@ public:
   void init();
 
   void printStats() override;
+  SchedulerStats getStats() override;
+
+  void setTimeInit(std::chrono::steady_clock::time_point timeInit) override;
+  vector<Dispatch> getDispatches() override { return mDispatches; }
+  size_t getDispatchesDropped() override { return 0; }
+  void setDecisionWriter(DecisionWriter* writer) override;
+  vector<tuple<size_t, ActionType>> getDurationOffsets() override
+  {
+    return mDurationOffsetActions.toVector();
+  }
 
   void saveDuration(ActionType action);
   void saveDurationOffset(ActionType action);
+  //! \brief Called by the scheduler thread before any work, then releases `start`.
+  void applyAffinity();
 
   void callback(int queueIndex) override;
+  void failWork(Device* device, int queueIndex) override;
+  void cancel() override;
+  size_t getQueueDepth() override;
+  size_t getUnservedRequests() override;
+  vector<tuple<size_t, size_t>> getCompletedRanges() override;
   void requestWork(Device* device) override;
   void enqueueWork(Device* device) override;
   void preEnqueueWork() override;
@@ -84,8 +105,19 @@ public:
   void setLws(size_t lws) override;
   void setOutPattern(uint outWorkitems, uint outPositions) override;
 
-private:
+protected:
+  //! \brief Called with mMutexWork locked, once the work of a failed device is queued to `to`.
+  virtual void notifyRecovered(int to, const Work& work);
+  void saveDispatch(int device, size_t offset, size_t size);
+  void saveRecovery(const Recovery& recovery);
+  void finish();
+  int getSurvivor();
+
   thread mThread;
+  vector<int> mCpus;
+  vector<int> mPlacement; // of mThread
+  Semaphore mSemaPinned;  // applyAffinity done
+  string mAffinityError;  // thrown by start
   size_t mSize;
   vector<Device*> mDevices;
   uint mNumDevices;
@@ -98,7 +130,14 @@ private:
   vector<uint> mChunkGiven;
   vector<uint> mChunkDone;
   bool mHasWork;
-  uint mDevicesWorking;
+  atomic<uint> mChunksPending;
+  vector<bool> mPackageGiven;
+  vector<bool> mFailed;
+  vector<Recovery> mRecovered;
+  vector<Dispatch> mDispatches;
+  DecisionWriter* mDecisionWriter;
+  vector<tuple<size_t, size_t>> mCompleted;
+  bool mCancelled;
   vector<tuple<size_t, size_t>> mProportions;
   vector<float> mRawProportions;
   WorkSplit mWorkSplit;
@@ -108,11 +147,10 @@ private:
   uint mOutWorkitems;
   uint mOutPositions;
 
-  mutex* mMutexDuration;
-  std::chrono::duration<double> mTimeInit;
-  std::chrono::duration<double> mTime;
-  vector<tuple<size_t, ActionType>> mDurationActions;
-  vector<tuple<size_t, ActionType>> mDurationOffsetActions;
+  std::chrono::steady_clock::time_point mTimeInit;
+  std::chrono::steady_clock::time_point mTime;
+  EventRing<tuple<size_t, ActionType>> mDurationActions;
+  EventRing<tuple<size_t, ActionType>> mDurationOffsetActions;
 };
 
 } // namespace ecl
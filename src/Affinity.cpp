@@ -0,0 +1,237 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#include "Affinity.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace ecl {
+
+vector<int>
+parseCpuList(const string& list)
+{
+  vector<int> cpus;
+  std::istringstream is(list);
+  string item;
+  while (std::getline(is, item, ',')) {
+    item.erase(std::remove_if(item.begin(), item.end(), ::isspace), item.end());
+    if (item.empty()) {
+      continue;
+    }
+    try {
+      size_t dash = item.find('-');
+      int first = std::stoi(item.substr(0, dash));
+      int last = dash == string::npos ? first : std::stoi(item.substr(dash + 1));
+      if (first < 0 || last < first) {
+        throw std::invalid_argument(item);
+      }
+      for (int cpu = first; cpu <= last; ++cpu) {
+        cpus.push_back(cpu);
+      }
+    } catch (std::logic_error&) {
+      throw std::runtime_error("invalid CPU list: " + list);
+    }
+  }
+  return cpus;
+}
+
+string
+formatCpuList(vector<int> cpus)
+{
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  string list;
+  for (size_t i = 0; i < cpus.size();) {
+    size_t j = i;
+    while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+      j++;
+    }
+    list += (list.empty() ? "" : ",") + std::to_string(cpus[i]);
+    if (j > i) {
+      list += "-" + std::to_string(cpus[j]);
+    }
+    i = j + 1;
+  }
+  return list;
+}
+
+vector<int>
+nodeCpus(int node)
+{
+  std::ifstream is("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+  string list;
+  if (node < 0 || !std::getline(is, list)) {
+    throw std::runtime_error("unknown NUMA node " + std::to_string(node));
+  }
+  return parseCpuList(list);
+}
+
+#ifdef __linux__
+static vector<int>
+fromSet(const cpu_set_t& set)
+{
+  vector<int> cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &set)) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+#endif
+
+vector<int>
+availableCpus()
+{
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+    throw std::runtime_error("cannot get the CPUs of the process");
+  }
+  return fromSet(set);
+#else
+  vector<int> cpus(std::max(1u, std::thread::hardware_concurrency()));
+  for (size_t i = 0; i < cpus.size(); ++i) {
+    cpus[i] = i;
+  }
+  return cpus;
+#endif
+}
+
+#ifdef __linux__
+static void
+pin(pthread_t thread, const vector<int>& cpus)
+{
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto cpu : cpus.empty() ? availableCpus() : cpus) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+      throw std::runtime_error("invalid CPU " + std::to_string(cpu));
+    }
+    CPU_SET(cpu, &set);
+  }
+  auto err = pthread_setaffinity_np(thread, sizeof(set), &set);
+  if (err != 0) {
+    throw std::runtime_error("cannot pin the thread to the CPUs " + formatCpuList(cpus) +
+                             " (error " + std::to_string(err) + ")");
+  }
+}
+
+static vector<int>
+placement(pthread_t thread)
+{
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (pthread_getaffinity_np(thread, sizeof(set), &set) != 0) {
+    return {};
+  }
+  return fromSet(set);
+}
+#else
+static void
+pin(const vector<int>& cpus)
+{
+  if (!cpus.empty()) {
+    throw std::runtime_error("thread affinity is not supported in this platform");
+  }
+}
+#endif
+
+void
+setThreadAffinity(std::thread& thread, const vector<int>& cpus)
+{
+#ifdef __linux__
+  pin(thread.native_handle(), cpus);
+#else
+  (void)thread;
+  pin(cpus);
+#endif
+}
+
+void
+setCurrentThreadAffinity(const vector<int>& cpus)
+{
+#ifdef __linux__
+  pin(pthread_self(), cpus);
+#else
+  pin(cpus);
+#endif
+}
+
+vector<int>
+getThreadAffinity(std::thread& thread)
+{
+  if (!thread.joinable()) {
+    return {};
+  }
+#ifdef __linux__
+  return placement(thread.native_handle());
+#else
+  return availableCpus();
+#endif
+}
+
+vector<int>
+getCurrentThreadAffinity()
+{
+#ifdef __linux__
+  return placement(pthread_self());
+#else
+  return availableCpus();
+#endif
+}
+
+AffinityPolicy::AffinityPolicy()
+  : mExclude(false)
+{}
+
+void
+AffinityPolicy::setScheduler(vector<int> cpus)
+{
+  mScheduler = move(cpus);
+}
+
+void
+AffinityPolicy::setDevice(uint id, vector<int> cpus)
+{
+  mDevices[id] = move(cpus);
+}
+
+void
+AffinityPolicy::setExcludeFromCpuDevices(bool exclude)
+{
+  mExclude = exclude;
+}
+
+vector<int>
+AffinityPolicy::getDevice(uint id) const
+{
+  auto it = mDevices.find(id);
+  return it == mDevices.end() ? vector<int>() : it->second;
+}
+
+vector<int>
+AffinityPolicy::reservedCpus() const
+{
+  vector<int> cpus = mScheduler;
+  for (auto& device : mDevices) {
+    cpus.insert(cpus.end(), device.second.begin(), device.second.end());
+  }
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  return cpus;
+}
+
+} // namespace ecl
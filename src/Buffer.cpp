@@ -12,6 +12,9 @@ namespace ecl {
 
 Buffer::Buffer(Direction direction)
   : mDirection(direction)
+  , mTransfers(0)
+  , mTransferredBytes(0)
+  , mTransferNs(0)
 {}
 
 Direction
@@ -62,4 +65,35 @@ Buffer::byBytes(size_t size)
   return mItemSize * size;
 }
 
+void
+Buffer::addTransfer(size_t bytes)
+{
+  mTransfers++;
+  mTransferredBytes += bytes;
+}
+
+void
+Buffer::addTransferTime(size_t ns)
+{
+  mTransferNs += ns;
+}
+
+size_t
+Buffer::transfers()
+{
+  return mTransfers;
+}
+
+size_t
+Buffer::transferredBytes()
+{
+  return mTransferredBytes;
+}
+
+size_t
+Buffer::transferNs()
+{
+  return mTransferNs;
+}
+
 } // namespace ecl
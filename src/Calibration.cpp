@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#include "Calibration.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace ecl {
+
+// lower bound for the measured times, avoiding divisions by zero in very fast probes
+static const double MIN_SECONDS = 1e-9;
+
+double
+DeviceProfile::writeBandwidth() const
+{
+  return writeBytes / std::max(writeSeconds, MIN_SECONDS);
+}
+
+double
+DeviceProfile::readBandwidth() const
+{
+  return readBytes / std::max(readSeconds, MIN_SECONDS);
+}
+
+double
+DeviceProfile::itemsPerSecond() const
+{
+  auto compute = std::max(kernelSeconds - launchSeconds, MIN_SECONDS);
+  return probeSize / compute;
+}
+
+double
+DeviceProfile::fixedSeconds() const
+{
+  return writeSeconds + launchSeconds;
+}
+
+double
+DeviceProfile::secondsPerItem() const
+{
+  if (probeSize == 0) {
+    throw std::runtime_error("device profile without probe size");
+  }
+  return 1.0 / itemsPerSecond() + readSeconds / probeSize;
+}
+
+/**
+ * Every selected device should finish at the same time T, so device i receives
+ * (T - fixed_i) / perItem_i work-items. Given a set of devices, T follows from the sum of the
+ * work-items being `size`. A device is worth adding only if its fixed cost is below T, so the best
+ * set is a prefix of the devices sorted by fixed cost: every prefix is evaluated.
+ */
+Calibration
+planDevices(const vector<DeviceProfile>& profiles, size_t size)
+{
+  if (profiles.empty()) {
+    throw std::runtime_error("planDevices requires at least one device profile");
+  }
+  if (size == 0) {
+    throw std::runtime_error("planDevices requires a problem size");
+  }
+  vector<size_t> order(profiles.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::sort(begin(order), end(order), [&](size_t a, size_t b) {
+    return profiles[a].fixedSeconds() < profiles[b].fixedSeconds();
+  });
+
+  double bestMakespan = std::numeric_limits<double>::max();
+  size_t bestLen = 0;
+  double sumInv = 0.0;
+  double sumFixedInv = 0.0;
+  for (size_t k = 0; k < order.size(); ++k) {
+    auto& profile = profiles[order[k]];
+    auto perItem = profile.secondsPerItem();
+    sumInv += 1.0 / perItem;
+    sumFixedInv += profile.fixedSeconds() / perItem;
+    double makespan = (size + sumFixedInv) / sumInv;
+    if (profile.fixedSeconds() >= makespan) {
+      break; // this device (and the slower to start) would finish after the others
+    }
+    if (makespan < bestMakespan) {
+      bestMakespan = makespan;
+      bestLen = k + 1;
+    }
+  }
+
+  Calibration calibration;
+  calibration.profiles = profiles;
+  calibration.makespan = bestMakespan;
+
+  vector<size_t> selected(begin(order), begin(order) + bestLen);
+  std::sort(begin(selected), end(selected)); // runtime order
+  for (auto i : selected) {
+    auto& profile = profiles[i];
+    auto items = (bestMakespan - profile.fixedSeconds()) / profile.secondsPerItem();
+    calibration.devices.push_back(profile.id);
+    calibration.proportions.push_back(static_cast<float>(items / size));
+  }
+  return calibration;
+}
+
+} // namespace ecl
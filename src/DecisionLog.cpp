@@ -0,0 +1,227 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#include "DecisionLog.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+
+namespace ecl {
+
+static const string MAGIC = "ECLDEC";
+static const char VERSION = 2;               // 1 had no lost bit in the devices
+static const int COUNT_BYTES = 10;           // a padded varint holds any 64 bits
+static const int RECORD_BYTES = 4;           // at least a byte per varint
+static const uint64_t RESERVE_MAX = 1 << 16; // records reserved while the size is unknown
+
+static void
+writeVarint(std::ostream& os, uint64_t value)
+{
+  do {
+    unsigned char byte = value & 0x7f;
+    value >>= 7;
+    if (value) {
+      byte |= 0x80;
+    }
+    os.put(static_cast<char>(byte));
+  } while (value);
+}
+
+static uint64_t
+readVarint(std::istream& is)
+{
+  uint64_t value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    auto c = is.get();
+    if (c == std::char_traits<char>::eof()) {
+      throw std::runtime_error("truncated decision log");
+    }
+    value |= static_cast<uint64_t>(c & 0x7f) << shift;
+    if (!(c & 0x80)) {
+      return value;
+    }
+  }
+  throw std::runtime_error("corrupted decision log");
+}
+
+//! \brief `value` in exactly COUNT_BYTES bytes (continuation bits on the padding).
+static void
+writePaddedVarint(std::ostream& os, uint64_t value)
+{
+  for (int i = 0; i < COUNT_BYTES; ++i) {
+    unsigned char byte = value & 0x7f;
+    value >>= 7;
+    if (i + 1 < COUNT_BYTES) {
+      byte |= 0x80;
+    }
+    os.put(static_cast<char>(byte));
+  }
+}
+
+//! \brief Bytes left in `is`, or -1 if it cannot seek (eg. a pipe).
+static std::streamoff
+remainingBytes(std::istream& is)
+{
+  auto here = is.tellg();
+  if (here == std::streampos(-1) || !is.seekg(0, std::ios::end)) {
+    is.clear();
+    return -1;
+  }
+  auto end = is.tellg();
+  is.seekg(here);
+  return end - here;
+}
+
+// the dispatches are saved in order, but a zigzag delta keeps any order valid
+static uint64_t
+zigzag(int64_t value)
+{
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+static int64_t
+unzigzag(uint64_t value)
+{
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+void
+DecisionLog::write(std::ostream& os) const
+{
+  os.write(MAGIC.data(), MAGIC.size());
+  os.put(VERSION);
+  writeVarint(os, size);
+  writeVarint(os, dispatches.size());
+  size_t previous = 0;
+  for (auto& d : dispatches) {
+    writeVarint(os, zigzag(static_cast<int64_t>(d.ts_ns) - static_cast<int64_t>(previous)));
+    writeVarint(os, static_cast<uint64_t>(d.device) << 1);
+    writeVarint(os, d.offset);
+    writeVarint(os, d.size);
+    previous = d.ts_ns;
+  }
+}
+
+void
+DecisionLog::save(const string& path) const
+{
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    throw std::runtime_error("cannot open the decision log " + path);
+  }
+  write(file);
+  if (!file) {
+    throw std::runtime_error("cannot write the decision log " + path);
+  }
+}
+
+DecisionLog
+DecisionLog::read(std::istream& is)
+{
+  string magic(MAGIC.size(), '\0');
+  is.read(&magic[0], magic.size());
+  if (!is || magic != MAGIC) {
+    throw std::runtime_error("not a decision log");
+  }
+  auto version = is.get();
+  if (version != 1 && version != VERSION) {
+    throw std::runtime_error("unsupported decision log version");
+  }
+  DecisionLog log;
+  log.size = readVarint(is);
+  auto count = readVarint(is);
+  auto remaining = remainingBytes(is);
+  if (remaining >= 0 && count > static_cast<uint64_t>(remaining) / RECORD_BYTES) {
+    throw std::runtime_error("corrupted decision log");
+  }
+  log.dispatches.reserve(remaining >= 0 ? count : std::min(count, RESERVE_MAX));
+  int64_t ts = 0;
+  for (uint64_t i = 0; i < count; ++i) {
+    Dispatch d;
+    ts += unzigzag(readVarint(is));
+    d.ts_ns = static_cast<size_t>(ts);
+    auto device = readVarint(is);
+    auto lost = version > 1 && (device & 1);
+    d.device = static_cast<int>(version > 1 ? device >> 1 : device);
+    d.offset = readVarint(is);
+    d.size = readVarint(is);
+    if (lost) {
+      auto& ds = log.dispatches;
+      auto it = std::find_if(ds.begin(), ds.end(), [&d](const Dispatch& other) {
+        return other.device == d.device && other.offset == d.offset && other.size == d.size;
+      });
+      if (it != ds.end()) {
+        ds.erase(it);
+      }
+    } else {
+      log.dispatches.push_back(d);
+    }
+  }
+  return log;
+}
+
+DecisionLog
+DecisionLog::load(const string& path)
+{
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("cannot open the decision log " + path);
+  }
+  return read(file);
+}
+
+DecisionWriter::DecisionWriter(const string& path, size_t size)
+  : mPath(path)
+  , mFile(path, std::ios::binary | std::ios::trunc)
+  , mRecords(0)
+  , mPrevious(0)
+{
+  if (!mFile) {
+    throw std::runtime_error("cannot open the decision log " + path);
+  }
+  mFile.write(MAGIC.data(), MAGIC.size());
+  mFile.put(VERSION);
+  writeVarint(mFile, size);
+  mCountPos = mFile.tellp();
+  writePaddedVarint(mFile, 0);
+}
+
+void
+DecisionWriter::append(const Dispatch& dispatch)
+{
+  appendRecord(dispatch.ts_ns, dispatch.device, false, dispatch.offset, dispatch.size);
+}
+
+void
+DecisionWriter::appendLost(int device, size_t offset, size_t size)
+{
+  appendRecord(mPrevious, device, true, offset, size);
+}
+
+void
+DecisionWriter::appendRecord(size_t ts_ns, int device, bool lost, size_t offset, size_t size)
+{
+  writeVarint(mFile, zigzag(static_cast<int64_t>(ts_ns) - static_cast<int64_t>(mPrevious)));
+  writeVarint(mFile, static_cast<uint64_t>(device) << 1 | (lost ? 1 : 0));
+  writeVarint(mFile, offset);
+  writeVarint(mFile, size);
+  mPrevious = ts_ns;
+  mRecords++;
+}
+
+void
+DecisionWriter::close()
+{
+  mFile.seekp(mCountPos);
+  writePaddedVarint(mFile, mRecords);
+  mFile.close();
+  if (!mFile) {
+    throw std::runtime_error("cannot write the decision log " + mPath);
+  }
+}
+
+} // namespace ecl
@@ -5,100 +5,154 @@
  */
 #include "Device.hpp"
 
+#include "Affinity.hpp"
 #include "Buffer.hpp"
+#include "HostOps.hpp"
 #include "Inspector.hpp"
+#include "Reactor.hpp"
 #include "Runtime.hpp"
 #include "Scheduler.hpp"
+#include "Stats.hpp"
+
+#include <algorithm>
+#include <iterator>
 
 #define USE_EVENTS 1
 // #define USE_EVENTS 0
 
-struct CBData
-{
-  int queue_index;
-  ecl::Device* device;
-  CBData(int queue_index_, ecl::Device* device_)
-    : queue_index(queue_index_)
-    , device(device_)
-  {}
-};
-
+/**
+ * \brief Completion of the read back of a chunk. The callback slot is released once read, before
+ * the scheduler callback (that may give the next chunk to the device).
+ */
 void CL_CALLBACK
-callbackRead(cl_event /*event*/, cl_int /*status*/, void* data)
+callbackRead(cl_event /*event*/, cl_int status, void* data)
 {
-  CBData* cbdata = reinterpret_cast<CBData*>(data);
+  ecl::CBData* cbdata = reinterpret_cast<ecl::CBData*>(data);
   ecl::Device* device = cbdata->device;
+  int queueIndex = cbdata->queue_index;
+#if ECL_SAVE_CHUNKS
+  auto chunked = cbdata->chunked;
+  auto chunk = cbdata->chunk;
+#endif
+  cbdata->busy.store(false, std::memory_order_release);
   ecl::Scheduler* scheduler = device->getScheduler();
+  if (status != CL_COMPLETE) {
+    device->quarantine(string("chunk failed with status ") + CLUtils::clErrorToStr(status));
+    scheduler->failWork(device, queueIndex);
+    return;
+  }
+#if ECL_HANDOFF_PROFILING
+  device->markHandOff(ecl::HandOffStep::Completed);
+#endif
 #if ECL_SAVE_CHUNKS
-  device->saveChunk();
+  if (chunked) {
+    device->saveChunk(chunk);
+  }
 #endif
-  device->saveDuration(ecl::ActionType::completeWork);
-  scheduler->callback(cbdata->queue_index);
-  delete cbdata;
+  device->saveCallbackDuration(ecl::ActionType::completeWork);
+  if (device->checkExit()) { // before the callback, so no more work is given
+    device->getRuntime()->exitFound(queueIndex);
+  }
+#if ECL_HANDOFF_PROFILING
+  device->markHandOff(ecl::HandOffStep::Callback);
+#endif
+  scheduler->callback(queueIndex);
 }
 
 namespace ecl {
 
-void
-device_thread_func(Device& device)
+//! \brief Bytes per ns are GB/s (0 without a measured time).
+static double
+gbps(size_t bytes, size_t ns)
 {
-  auto time1 = std::chrono::system_clock::now().time_since_epoch();
-  device.init();
-  Scheduler* scheduler = device.getScheduler();
-  device.saveDuration(ActionType::deviceStart);
-  device.saveDurationOffset(ActionType::deviceStart);
-
-  Runtime* runtime = device.getRuntime();
-  device.saveDuration(ActionType::deviceReady);
-  device.saveDurationOffset(ActionType::deviceReady);
-  runtime->notifyReady();
-  runtime->notifyAllReady();
-
-  device.waitRun();
-  device.saveDuration(ActionType::deviceRun);
-  device.saveDurationOffset(ActionType::deviceRun);
-
-  scheduler->requestWork(&device);
-
-  auto cont = true;
-  while (cont) {
-    device.waitWork();
-    auto queue_index = scheduler->getWorkIndex(&device);
-
-    if (queue_index >= 0) { //
-      Work work = scheduler->getWork(queue_index);
+  return ns > 0 ? static_cast<double>(bytes) / ns : 0.0;
+}
 
-      device.doWork(work.mOffset, work.mSize, work.mOutWorkitems, work.mOutPositions, queue_index);
-    } else {
-      device.notifyBarrier();
-      cont = false;
-    }
+static void
+addBufferStats(DeviceStats& stats, const string& direction, vector<Buffer>& buffers)
+{
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    auto& b = buffers[i];
+    stats.buffers.push_back({ direction,
+                              i,
+                              b.bytes(),
+                              b.transfers(),
+                              b.transferredBytes(),
+                              b.transferNs(),
+                              gbps(b.transferredBytes(), b.transferNs()) });
   }
+}
 
-  device.saveDuration(ActionType::deviceEnd);
-  device.saveDurationOffset(ActionType::deviceEnd);
+/**
+ * Errors (OpenCL or not) are captured per device: a failing device is quarantined and the chunk
+ * it was computing goes back to the scheduler, so the surviving devices complete the run.
+ */
+void
+device_thread_func(Device& device)
+{
+  try {
+    device.applyAffinity();
+  } catch (std::exception& e) {
+    device.quarantine(e.what());
+  }
+  device.initStage();
+  if (!device.dataStage() || !device.runStage()) {
+    return;
+  }
+  do {
+    device.waitWork();
+  } while (device.workStep());
 }
 
 Device::Device(uint selPlatform, uint selDevice)
   : mSelPlatform(selPlatform)
   , mSelDevice(selDevice)
+  , mRuntime(nullptr)
+  , mReactor(nullptr)
+  , mReservedCpus(0)
   , mNumArgs(0)
+  , mNodeLocalStaging(false)
+  , mHost(false)
+  , mHostThreads(0)
+  , mSimulated(false)
+  , mSpin(false)
+  , mSimulatedDebtNs(0)
+  , mDurationActions(64)
+  , mCallbackActions(ECL_EVENTS_CAPACITY)
+  , mDurationOffsetActions(64)
   , mProgramType(ProgramType::Source)
   , mMinMultiplier(1)
+  , mQuarantined(make_unique<std::atomic<bool>>(false))
+  , mReleased(false)
+  , mProfiling(false)
+  , mHasExitFlag(false)
+  , mExitRaised(false)
+  , mExitFlag(0)
+  , mHostExit(make_unique<std::atomic<bool>>(false))
+#if ECL_SAVE_CHUNKS
+  , mChunks(ECL_EVENTS_CAPACITY)
+  , mChunkUnsaved(false)
+#endif
+#if ECL_HANDOFF_PROFILING
+  , mHandOffs(ECL_EVENTS_CAPACITY)
+  , mHandOffSteps(make_unique<std::atomic<size_t>[]>(6))
+#endif
 {
-  mMutexDuration = new mutex();
-  mTimeInit = std::chrono::system_clock::now().time_since_epoch();
-  mTime = std::chrono::system_clock::now().time_since_epoch();
+  mTimeInit = std::chrono::steady_clock::now();
+  mTime = std::chrono::steady_clock::now();
   mWorks = 0;
   mWorksSize = 0;
+  mWrites = 0;
+  mWriteBytes = 0;
+  mReads = 0;
+  mReadBytes = 0;
   mSemaWork = new Semaphore(1);
   mSemaRun = make_unique<Semaphore>(1);
-  mDurationActions.reserve(1024);    // NOTE improve
-  mDurationOffsetActions.reserve(8); // the reserve
-
-#if ECL_SAVE_CHUNKS
-  mChunks.reserve(160);
-#endif
+  mSemaData = make_unique<Semaphore>(1);
+  mMetrics = make_unique<DeviceMetrics>();
+  mCallbackSlots = make_unique<CBData[]>(ECL_DEVICE_PIPELINE);
+  mCallbackSlot = 0;
+  mKernelEvents = vector<cl::Event>(1);
 }
 
 Device::~Device()
@@ -125,11 +179,17 @@ Device::printStats()
       cout << "source\n";
   }
   cout << "kernel: " << mKernelStr << "\n";
+  if (isQuarantined()) {
+    cout << "quarantined: " << mFailure << "\n";
+  }
   cout << "works: " << mWorks << " works_size: " << mWorksSize << "\n";
+  cout << "cpus: " << formatCpuList(mPlacement) << "\n";
+  cout << "transfers: writes: " << mWrites << " (" << mWriteBytes << " bytes) reads: " << mReads
+       << " (" << mReadBytes << " bytes)\n";
   size_t acc = 0;
   size_t total = 0;
   cout << "duration increments:\n";
-  for (auto& t : mDurationActions) {
+  for (auto& t : getDurations()) {
     auto d = std::get<0>(t);
     auto action = std::get<1>(t);
     if (action == ActionType::completeWork) {
@@ -139,10 +199,14 @@ Device::printStats()
     }
     total += d;
   }
-  cout << " completeWork: " << acc << " ms.\n";
-  cout << " total: " << total << " ms.\n";
+  Inspector::printDuration("completeWork", acc);
+  Inspector::printDuration("total", total);
+  auto dropped = mDurationActions.dropped() + mCallbackActions.dropped();
+  if (dropped > 0) {
+    cout << " (oldest " << dropped << " durations dropped)\n";
+  }
   cout << "duration offsets from init:\n";
-  for (auto& t : mDurationOffsetActions) {
+  for (auto& t : mDurationOffsetActions.toVector()) {
     Inspector::printActionTypeDuration(std::get<1>(t), std::get<0>(t));
   }
 #if USE_EVENTS
@@ -151,59 +215,148 @@ Device::printStats()
   cout << "use events: no\n";
 #endif
 
+  printProfiling();
+
 #if ECL_SAVE_CHUNKS
   cout << "chunks (mOffset+mSize:ts_ms+duration_ms)";
   cout << "type-chunks,";
-  for (auto chunk : mChunks) {
-    cout << chunk.offset << "+" << chunk.size << ":" << chunk.ts_ms << "+" << chunk.duration_ms
-         << ",";
+  for (auto chunk : mChunks.toVector()) {
+    cout << chunk.offset << "+" << chunk.size << ":" << Inspector::toMs(chunk.ts_ns) << "+"
+         << Inspector::toMs(chunk.duration_ns) << ",";
   }
   cout << "\n";
 #endif
 }
 
 #if ECL_SAVE_CHUNKS
+//! \brief Starts the chunk launched next, handed to its callback in the slot.
 void
 Device::initChunk(size_t offset, size_t size)
 {
+  auto t2 = std::chrono::steady_clock::now();
   mChunk.offset = offset;
   mChunk.size = size;
-  auto t2 = std::chrono::system_clock::now().time_since_epoch();
-  size_t diff_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - mTimeInit).count();
-  mChunk.ts_ms = diff_ms;
+  mChunk.ts_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - mTimeInit).count();
+  mChunk.work = mWorks;
   mChunkUnsaved = true;
 }
 
+//! \brief From the completion callbacks, the only writers of the chunks.
+void
+Device::saveChunk(const Chunk& chunk)
+{
+  auto t2 = std::chrono::steady_clock::now();
+  size_t diff_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - mTimeInit).count();
+  size_t duration_ns = diff_ns - chunk.ts_ns;
+  mChunks.push(Chunk(chunk.offset, chunk.size, chunk.ts_ns, duration_ns, chunk.work));
+}
+#endif
+
+#if ECL_HANDOFF_PROFILING
 void
-Device::saveChunk()
+Device::markHandOff(HandOffStep step)
 {
-  if (mChunkUnsaved) {
-    auto t2 = std::chrono::system_clock::now().time_since_epoch();
-    size_t diff_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - mTimeInit).count();
-    size_t duration_ms = diff_ms - mChunk.ts_ms;
-    mChunks.push_back(Chunk(mChunk.offset, mChunk.size, mChunk.ts_ms, duration_ms));
-    mChunkUnsaved = false;
+  auto t2 = std::chrono::steady_clock::now();
+  markHandOff(step, std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - mTimeInit).count());
+}
+
+/**
+ * \brief The device thread marks its steps, the callbacks the completion and the scheduler the
+ * Wake and Enqueued ones, before `notifyWork`. Launching a chunk after a completed one saves the
+ * hand-off, so only the launching thread pushes them.
+ */
+void
+Device::markHandOff(HandOffStep step, size_t ns)
+{
+  mHandOffSteps[static_cast<int>(step)].store(ns, std::memory_order_relaxed);
+  if (step == HandOffStep::Launched) {
+    HandOff handOff;
+    for (int i = 0; i <= static_cast<int>(HandOffStep::Launched); ++i) {
+      handOff.steps[i] = mHandOffSteps[i].exchange(0, std::memory_order_relaxed);
+    }
+    if (handOff.steps[static_cast<int>(HandOffStep::Completed)] > 0) {
+      mHandOffs.push(handOff);
+    }
   }
 }
 #endif
 
+//! \brief From the device thread (its stages).
 void
 Device::saveDuration(ActionType action)
 {
-  lock_guard<mutex> lock(*mMutexDuration);
-  auto t2 = std::chrono::system_clock::now().time_since_epoch();
-  size_t diff_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - mTime).count();
-  mDurationActions.push_back(make_tuple(diff_ms, action));
-  mTime = t2;
+  auto ns = std::chrono::steady_clock::now().time_since_epoch();
+  mDurationActions.push(
+    make_tuple(std::chrono::duration_cast<std::chrono::nanoseconds>(ns).count(), action));
 }
+
+//! \brief From the completion callbacks, as `saveDuration` in a ring of their own.
+void
+Device::saveCallbackDuration(ActionType action)
+{
+  auto ns = std::chrono::steady_clock::now().time_since_epoch();
+  mCallbackActions.push(
+    make_tuple(std::chrono::duration_cast<std::chrono::nanoseconds>(ns).count(), action));
+}
+
+/**
+ * \brief The durations of the device thread and the callbacks merged by time, each one as the
+ * increment from the previous (or from `init`). Read once the writers are done.
+ */
+vector<tuple<size_t, ActionType>>
+Device::getDurations()
+{
+  auto thread = mDurationActions.toVector();
+  auto callbacks = mCallbackActions.toVector();
+  vector<tuple<size_t, ActionType>> durations;
+  durations.reserve(thread.size() + callbacks.size());
+  std::merge(thread.begin(),
+             thread.end(),
+             callbacks.begin(),
+             callbacks.end(),
+             std::back_inserter(durations),
+             [](const tuple<size_t, ActionType>& a, const tuple<size_t, ActionType>& b) {
+               return std::get<0>(a) < std::get<0>(b);
+             });
+  size_t previous = std::chrono::duration_cast<std::chrono::nanoseconds>(mTime.time_since_epoch())
+                      .count();
+  for (auto& t : durations) {
+    auto ts = std::get<0>(t);
+    std::get<0>(t) = ts > previous ? ts - previous : 0;
+    previous = std::max(ts, previous);
+  }
+  return durations;
+}
+
 #include <memory>
 void
 Device::saveDurationOffset(ActionType action)
 {
-  lock_guard<mutex> lock(*mMutexDuration);
-  auto t2 = std::chrono::system_clock::now().time_since_epoch();
-  size_t diff_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - mTimeInit).count();
-  mDurationOffsetActions.push_back(make_tuple(diff_ms, action));
+  auto t2 = std::chrono::steady_clock::now();
+  size_t diff_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - mTimeInit).count();
+  mDurationOffsetActions.push(make_tuple(diff_ns, action));
+}
+
+void
+Device::quarantine(const string& reason)
+{
+  IF_LOGGING(cout << "device " << mId << " quarantined: " << reason << "\n");
+  // the first failure is kept (it is read once the device is done)
+  if (!mQuarantined->exchange(true, std::memory_order_acq_rel)) {
+    mFailure = reason;
+  }
+}
+
+bool
+Device::isQuarantined()
+{
+  return mQuarantined->load(std::memory_order_acquire);
+}
+
+const string&
+Device::getFailure()
+{
+  return mFailure;
 }
 
 void
@@ -229,6 +382,53 @@ Device::setKernelArgLocalAlloc(cl_uint index, const uint bytes)
   mNumArgs++;
 }
 
+/**
+ * \brief The kernel receives at `index` a `__global int*` flag (initially 0). A kernel raising it
+ * (eg. `*flag = 1` when the search finds the answer) stops the run once the chunk completes. The
+ * host kernels raise it with `HostDevice::raiseExit`.
+ */
+void
+Device::setKernelArgExitFlag(cl_uint index)
+{
+  mArgIndex.push_back(index);
+  mArgType.push_back(ArgType::ExitFlag);
+  mArgBytes.push_back(sizeof(cl_int));
+  mArgPtr.push_back(NULL);
+  mNumArgs++;
+  mHasExitFlag = true;
+}
+
+//! \brief True the first time the completed chunk finds the exit flag raised.
+bool
+Device::checkExit()
+{
+  if (mHasExitFlag && mExitFlag != 0 && !mExitRaised) {
+    mExitRaised = true;
+    return true;
+  }
+  return false;
+}
+
+void
+Device::resetExit()
+{
+  mExitFlag = 0;
+  mExitRaised = false;
+  mHostExit->store(false, std::memory_order_relaxed);
+}
+
+// exit flag of the host device whose kernel the thread is computing
+static thread_local std::atomic<bool>* tHostExit = nullptr;
+
+void
+Device::raiseHostExit()
+{
+  if (tHostExit == nullptr) {
+    throw runtime_error("raiseExit should be called from a host kernel");
+  }
+  tHostExit->store(true, std::memory_order_relaxed);
+}
+
 void
 Device::setScheduler(Scheduler* scheduler)
 {
@@ -277,16 +477,51 @@ Device::notifyRun()
   mSemaRun.get()->notify(1);
 }
 
+void
+Device::waitData()
+{
+  mSemaData.get()->wait(1);
+}
+
+void
+Device::notifyData()
+{
+  mSemaData.get()->notify(1);
+}
+
+void
+Device::release()
+{
+  mReleased = true;
+  notifyData();
+  notifyRun();
+}
+
 void
 Device::waitWork()
 {
+  auto t1 = std::chrono::steady_clock::now();
   mSemaWork->wait(1);
+  auto t2 = std::chrono::steady_clock::now();
+  mMetrics->waitNs.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count(),
+                             std::memory_order_relaxed);
+}
+
+//! \brief As `waitWork`, giving up after `timeout` (false). A 0 timeout polls (`Simulator`).
+bool
+Device::waitWork(std::chrono::nanoseconds timeout)
+{
+  return mSemaWork->wait_for(timeout);
 }
 
 void
 Device::notifyWork()
 {
-  mSemaWork->notify(1);
+  if (mReactor != nullptr) {
+    mReactor->notify(mId);
+  } else {
+    mSemaWork->notify(1);
+  }
 }
 
 string&
@@ -300,6 +535,362 @@ Device::start()
 {
   mThread = thread(device_thread_func, std::ref(*this));
 }
+void
+Device::setAffinity(vector<int> cpus)
+{
+  mCpus = move(cpus);
+}
+
+void
+Device::setHost(size_t threads)
+{
+  mHost = true;
+  mHostThreads = threads;
+}
+
+void
+Device::setHostKernel(ThreadPool::Task kernel)
+{
+  mHostKernel = move(kernel);
+}
+
+/**
+ * \brief Creates the pool in the thread of the device, so the workers inherit its affinity. By
+ * default it has a thread per CPU of the device thread, less the CPUs reserved for other threads.
+ */
+void
+Device::initHost()
+{
+  if (!mHostKernel) {
+    throw runtime_error("host device without kernel (see Runtime::setHostKernel)");
+  }
+  auto threads = mHostThreads;
+  if (threads == 0) {
+    auto cpus = mPlacement.empty() ? availableCpus().size() : mPlacement.size();
+    threads = cpus > mReservedCpus ? cpus - mReservedCpus : 1;
+  }
+  mPool = make_unique<ThreadPool>(threads);
+  auto exit = mHostExit.get();
+  auto kernel = mHostKernel;
+  mHostTask = [exit, kernel](size_t offset, size_t size) {
+    tHostExit = exit;
+    kernel(offset, size);
+  };
+}
+
+//! \brief Computes the chunk in the pool and completes it as the read callback of OpenCL devices.
+void
+Device::doHostWork(size_t offset, size_t size, int queueIndex)
+{
+#if ECL_SAVE_CHUNKS
+  initChunk(offset, size);
+#endif
+#if ECL_HANDOFF_PROFILING
+  markHandOff(HandOffStep::Launched);
+#endif
+  mPool->parallelFor(offset, size, mLws, mHostTask);
+  if (mHostExit->exchange(false)) { // the pool is done, as a read back of the flag
+    mExitFlag = 1;
+  }
+  mWorks++;
+  mWorksSize += size;
+  mMetrics->chunks.fetch_add(1, std::memory_order_relaxed);
+  mMetrics->items.fetch_add(size, std::memory_order_relaxed);
+  callbackRead(nullptr, CL_COMPLETE, acquireCallbackSlot(queueIndex));
+}
+
+//! \brief As `probe`, without transfers.
+void
+Device::probeHost(size_t size)
+{
+  using clock = std::chrono::steady_clock;
+  auto seconds = [](clock::time_point t1, clock::time_point t2) {
+    return std::chrono::duration<double>(t2 - t1).count();
+  };
+  mProfile.id = mId;
+  mProfile.platform = mSelPlatform;
+  mProfile.device = mSelDevice;
+  mProfile.probeSize = size;
+  mProfile.writeBytes = 0;
+  mProfile.writeSeconds = 0.0;
+  mProfile.readBytes = 0;
+  mProfile.readSeconds = 0.0;
+
+  mPool->parallelFor(0, mLws, mLws, mHostTask); // warms up the caches of the pool
+  auto t1 = clock::now();
+  mPool->parallelFor(0, mLws, mLws, mHostTask);
+  mProfile.launchSeconds = seconds(t1, clock::now());
+  t1 = clock::now();
+  mPool->parallelFor(0, size, mLws, mHostTask);
+  mProfile.kernelSeconds = seconds(t1, clock::now());
+}
+
+void
+Device::setSimulated(const DeviceModel& model, bool spin)
+{
+  if (model.itemsPerSecond <= 0.0) {
+    throw runtime_error("the model of " + model.name + " requires a throughput");
+  }
+  mSimulated = true;
+  mModel = model;
+  mSpin = spin;
+}
+
+static size_t
+toNs(double seconds)
+{
+  return static_cast<size_t>(std::round(std::max(seconds, 0.0) * 1e9));
+}
+
+/**
+ * \brief Waits `ns` in real time. The time overslept (waking up late) is taken from the next
+ * wait, so the busy time of the device follows its model however long the OS takes to wake it.
+ */
+void
+Device::simulate(size_t ns)
+{
+  using clock = std::chrono::steady_clock;
+  auto paid = std::min(ns, mSimulatedDebtNs);
+  mSimulatedDebtNs -= paid;
+  auto deadline = clock::now() + std::chrono::nanoseconds(ns - paid);
+  if (mSpin) {
+    while (clock::now() < deadline) {
+    }
+  } else {
+    std::this_thread::sleep_until(deadline);
+  }
+  auto late = clock::now() - deadline;
+  mSimulatedDebtNs += std::chrono::duration_cast<std::chrono::nanoseconds>(late).count();
+}
+
+//! \brief As the command profiles of OpenCL devices, in host ns (when profiling).
+void
+Device::saveSimulatedCommand(CommandType type, size_t start, size_t ns, size_t bytes)
+{
+  if (!mProfiling) {
+    return;
+  }
+  CommandProfile profile;
+  profile.type = type;
+  profile.enqueued = start;
+  profile.chunk = type == CommandType::Write ? -1 : static_cast<int>(mWorks);
+  profile.buffer = -1;
+  profile.bytes = bytes;
+  profile.queued = start;
+  profile.submit = start;
+  profile.start = start;
+  profile.end = start + ns;
+  mCommandProfiles.push_back(profile);
+}
+
+void
+Device::simulateWrite()
+{
+  auto t1 = std::chrono::steady_clock::now();
+  auto ns = toNs(mModel.writeSeconds());
+  simulate(ns);
+  if (mModel.writeBytes > 0) {
+    auto start = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - mTimeInit).count();
+    saveSimulatedCommand(CommandType::Write, start, ns, mModel.writeBytes);
+    saveTransfer(CommandType::Write, -1, mModel.writeBytes);
+  }
+}
+
+//! \brief Waits the launch, kernel and read back of the model, as `Simulator` in virtual time.
+void
+Device::doSimulatedWork(size_t offset, size_t size, int queueIndex)
+{
+#if ECL_SAVE_CHUNKS
+  initChunk(offset, size);
+#endif
+#if ECL_HANDOFF_PROFILING
+  markHandOff(HandOffStep::Launched);
+#endif
+  auto t1 = std::chrono::steady_clock::now();
+  auto factor = 1.0;
+  if (mModel.noise > 0.0) {
+    std::normal_distribution<double> normal(0.0, 1.0);
+    factor = std::max(0.0, 1.0 + mModel.noise * normal(mRng));
+  }
+  auto launch = toNs(mModel.launchSeconds);
+  auto kernel = toNs(size / mModel.itemsPerSecond * factor);
+  auto read = toNs(mModel.readSeconds(size));
+  simulate(launch + kernel + read);
+
+  size_t start = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - mTimeInit).count();
+  saveSimulatedCommand(CommandType::Kernel, start + launch, kernel, 0);
+  auto readBytes = static_cast<size_t>(size * mModel.readBytesPerItem);
+  if (readBytes > 0) {
+    saveSimulatedCommand(CommandType::Read, start + launch + kernel, read, readBytes);
+    saveTransfer(CommandType::Read, -1, readBytes);
+  }
+  mWorks++;
+  mWorksSize += size;
+  mMetrics->chunks.fetch_add(1, std::memory_order_relaxed);
+  mMetrics->items.fetch_add(size, std::memory_order_relaxed);
+  callbackRead(nullptr, CL_COMPLETE, acquireCallbackSlot(queueIndex));
+}
+
+//! \brief Chunk of a host or simulated device in its launcher (reactor mode), failing as in
+//! `workStep`.
+void
+Device::launchWork(size_t offset, size_t size, int queueIndex)
+{
+  try {
+    if (mHost) {
+      doHostWork(offset, size, queueIndex);
+    } else {
+      doSimulatedWork(offset, size, queueIndex);
+    }
+  } catch (std::exception& e) {
+    quarantine(e.what());
+    mScheduler->failWork(this, queueIndex);
+  }
+}
+
+//! \brief The profile of the model (`DeviceModel::fromProfile` gives it back), without waiting.
+void
+Device::probeSimulated(size_t size)
+{
+  mProfile.id = mId;
+  mProfile.platform = mSelPlatform;
+  mProfile.device = mSelDevice;
+  mProfile.probeSize = size;
+  mProfile.writeBytes = mModel.writeBytes;
+  mProfile.writeSeconds = mModel.writeSeconds();
+  mProfile.launchSeconds = mModel.launchSeconds;
+  mProfile.kernelSeconds = mModel.launchSeconds + size / mModel.itemsPerSecond; // as measured
+  mProfile.readBytes = static_cast<size_t>(size * mModel.readBytesPerItem);
+  mProfile.readSeconds = mModel.readSeconds(size);
+}
+
+void
+Device::setNodeLocalStaging(bool staging)
+{
+  mNodeLocalStaging = staging;
+}
+
+void
+Device::setReservedCpus(uint count)
+{
+  mReservedCpus = count;
+}
+
+//! \brief Called by the thread of the device, before it touches OpenCL.
+void
+Device::applyAffinity()
+{
+  if (!mCpus.empty()) {
+    setCurrentThreadAffinity(mCpus);
+  }
+  mPlacement = getCurrentThreadAffinity();
+}
+
+//! \brief Warms up the device (context, queue and program), quarantining it on failure.
+void
+Device::initStage()
+{
+  try {
+    init();
+  } catch (std::exception& e) {
+    quarantine(e.what());
+  }
+}
+
+/**
+ * \brief Once the runtime gives the data: creates and writes the buffers, then tells it is ready
+ * (true), or false if the device was released instead.
+ */
+bool
+Device::dataStage()
+{
+  waitData();
+  if (mReleased) {
+    return false;
+  }
+  saveDuration(ActionType::dataReady);
+  saveDurationOffset(ActionType::dataReady);
+  if (!isQuarantined()) {
+    try {
+      initData();
+    } catch (std::exception& e) {
+      quarantine(e.what());
+    }
+  }
+  saveDuration(ActionType::deviceStart);
+  saveDurationOffset(ActionType::deviceStart);
+
+  saveDuration(ActionType::deviceReady);
+  saveDurationOffset(ActionType::deviceReady);
+  mRuntime->notifyReady();
+  mRuntime->notifyAllReady();
+  return true;
+}
+
+/**
+ * \brief Once the runtime runs: requests the first work (true), or probes the device when
+ * calibrating and releases a quarantined device (false, the device is done).
+ */
+bool
+Device::runStage()
+{
+  waitRun();
+  saveDuration(ActionType::deviceRun);
+  saveDurationOffset(ActionType::deviceRun);
+
+  if (mRuntime->isCalibrating()) {
+    if (!isQuarantined()) {
+      try {
+        mRuntime->probe(*this);
+      } catch (std::exception& e) {
+        quarantine(e.what());
+      }
+    }
+    notifyBarrier();
+    return false;
+  }
+
+  if (isQuarantined()) {
+    mScheduler->failWork(this, -1);
+    saveDuration(ActionType::deviceEnd);
+    saveDurationOffset(ActionType::deviceEnd);
+    notifyBarrier();
+    return false;
+  }
+
+  mScheduler->requestWork(this);
+  return true;
+}
+
+/**
+ * \brief Once woken by the scheduler: enqueues the next work (true), or finishes the device
+ * (false) if there is no more.
+ */
+bool
+Device::workStep()
+{
+#if ECL_HANDOFF_PROFILING
+  markHandOff(HandOffStep::Resumed);
+#endif
+  auto queue_index = mScheduler->getWorkIndex(this);
+  if (queue_index >= 0) {
+    Work work = mScheduler->getWork(queue_index);
+    try {
+      doWork(work.mOffset, work.mSize, work.mOutWorkitems, work.mOutPositions, queue_index);
+    } catch (std::exception& e) {
+      quarantine(e.what());
+      mScheduler->failWork(this, queue_index); // wakes this device to leave
+    }
+    return true;
+  }
+  collectProfiling();
+
+  saveDuration(ActionType::deviceEnd);
+  saveDurationOffset(ActionType::deviceEnd);
+  notifyBarrier();
+  return false;
+}
+
 void
 Device::useRuntimeDiscovery()
 {
@@ -339,7 +930,9 @@ Device::waitEvent()
 void
 Device::notifyEvent()
 {
-  mEnd.setStatus(CL_COMPLETE);
+  if (mEnd() != nullptr) { // not created if the device failed during its initialization
+    mEnd.setStatus(CL_COMPLETE);
+  }
 }
 
 void
@@ -348,26 +941,68 @@ Device::setBarrier(shared_ptr<Semaphore> barrier)
   mBarrier = barrier;
 }
 
+/**
+ * \brief Takes the next callback slot, waiting while its chunk (ECL_DEVICE_PIPELINE chunks ago)
+ * is still reading back.
+ */
+CBData*
+Device::acquireCallbackSlot(int queueIndex)
+{
+  auto& slot = mCallbackSlots[mCallbackSlot++ % ECL_DEVICE_PIPELINE];
+  while (slot.busy.load(std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
+  slot.queue_index = queueIndex;
+  slot.device = this;
+#if ECL_SAVE_CHUNKS
+  slot.chunk = mChunk;
+  slot.chunked = mChunkUnsaved;
+  mChunkUnsaved = false;
+#endif
+  slot.busy.store(true, std::memory_order_relaxed);
+  return &slot;
+}
+
+/**
+ * Launches the kernel of the chunk and reads back its output. Nothing is allocated: the callback
+ * data is a preallocated slot and the events are members reused by every chunk. The queue is in
+ * order, so the reads only wait for the kernel, and their events are only kept when profiling
+ * (but the last one, for the callback).
+ */
 void
 Device::doWork(size_t poffset, size_t size, uint outWorkitems, uint outPosition, int queueIndex)
 {
   if (!size) {
-    return callbackRead(nullptr, CL_COMPLETE, this);
+    return callbackRead(nullptr, CL_COMPLETE, acquireCallbackSlot(queueIndex));
+  }
+  if (mLauncher) {
+    return mLauncher->submit(poffset, size, queueIndex);
+  }
+  if (mHost) {
+    return doHostWork(poffset, size, queueIndex);
+  }
+  if (mSimulated) {
+    return doSimulatedWork(poffset, size, queueIndex);
   }
   if (mPreviousEvents.size() && mWorks) {
     mPreviousEvents.clear();
   }
-  cl::Event evkernel;
+  cl::Event& evkernel = mKernelEvents[0];
 
   auto gws = size;
   size = outWorkitems * size / outPosition;
   size_t offset = outWorkitems * poffset / outPosition;
 
   cl_int cl_err;
+  // the reactor thread drives every device, so it never waits for the read back
+  cl_bool blocking = ECL_OPERATION_BLOCKING_READ == 1 && mReactor == nullptr ? CL_TRUE : CL_FALSE;
 
 #if ECL_SAVE_CHUNKS
   initChunk(offset, size);
 #endif
+#if ECL_HANDOFF_PROFILING
+  markHandOff(HandOffStep::Launched);
+#endif
 
 #if ECL_KERNEL_GLOBAL_WORK_OFFSET_SUPPORTED == 1
   cl_err = mQueue.enqueueNDRangeKernel(mKernel,
@@ -382,65 +1017,162 @@ Device::doWork(size_t poffset, size_t size, uint outWorkitems, uint outPosition,
     mKernel, cl::NullRange, cl::NDRange(gws), cl::NDRange(mLws), &mPreviousEvents, &evkernel);
 #endif
   CL_CHECK_ERROR(cl_err, "enqueue kernel");
+  saveCommand(CommandType::Kernel, evkernel);
+
+  if (mHasExitFlag) { // read before the outputs, so it is done when the last read completes
+    cl_err = mQueue.enqueueReadBuffer(mExitFlagBuffer,
+                                      blocking,
+                                      0,
+                                      sizeof(cl_int),
+                                      &mExitFlag,
 #if USE_EVENTS
-  cl::Event evread;
-  vector<cl::Event> events({ evkernel });
+                                      &mKernelEvents,
+                                      mProfiling ? &mFlagEvent : nullptr);
+    saveCommand(CommandType::Read, mFlagEvent, -1, sizeof(cl_int));
+#else
+                                      NULL,
+                                      NULL);
 #endif
+    CL_CHECK_ERROR(cl_err, "enqueue read exit flag");
+    saveTransfer(CommandType::Read, -1, sizeof(cl_int));
+  }
 
   auto len = mOutEclBuffers.size();
   for (uint i = 0; i < len; ++i) {
-#if USE_EVENTS
-    vector<cl::Event> levents = events;
-    cl::Event levread;
-#endif
     Buffer& b = mOutEclBuffers[i];
     size_t size_bytes = b.byBytes(size);
     auto offset_bytes = b.byBytes(offset);
     cl_err = mQueue.enqueueReadBuffer(mOutBuffers[i],
-#if ECL_OPERATION_BLOCKING_READ == 1
-                                      CL_TRUE,
-#else
-                                      CL_FALSE,
-#endif
+                                      blocking,
                                       offset_bytes,
                                       size_bytes,
                                       b.dataWithOffset(offset),
 #if USE_EVENTS
-                                      &levents,
-                                      &levread);
-    events.push_back(levread);
-    evread = levread;
+                                      &mKernelEvents,
+                                      mProfiling || i + 1 == len ? &mReadEvent : nullptr);
+    saveCommand(CommandType::Read, mReadEvent, i, size_bytes);
 #else
                                       NULL,
                                       NULL);
 #endif
     CL_CHECK_ERROR(cl_err, "enqueue read buffer");
+    saveTransfer(CommandType::Read, i, size_bytes);
   }
-  auto cbdata = new CBData(queueIndex, this);
+  auto cbdata = acquireCallbackSlot(queueIndex);
 
-#if ECL_OPERATION_BLOCKING_READ == 1
+  if (blocking) {
 #if USE_EVENTS
-  callbackRead(evread(), CL_COMPLETE, cbdata);
-#else
-  callbackRead(nullptr, CL_COMPLETE, cbdata);
-#endif
+    callbackRead(mReadEvent(), CL_COMPLETE, cbdata);
 #else
-  evread.setCallback(CL_COMPLETE, callbackRead, cbdata);
+    callbackRead(nullptr, CL_COMPLETE, cbdata);
 #endif
+  } else {
+    mReadEvent.setCallback(CL_COMPLETE, callbackRead, cbdata);
+  }
   mQueue.flush();
   mWorks++;
   mWorksSize += size;
+  mMetrics->chunks.fetch_add(1, std::memory_order_relaxed);
+  mMetrics->items.fetch_add(size, std::memory_order_relaxed);
+}
+
+void
+Device::enqueueProbeKernel(size_t size)
+{
+  cl_int cl_err;
+#if ECL_KERNEL_GLOBAL_WORK_OFFSET_SUPPORTED == 1
+  cl_err = mQueue.enqueueNDRangeKernel(
+    mKernel, cl::NDRange(0), cl::NDRange(size), cl::NDRange(mLws), &mPreviousEvents, nullptr);
+#else
+  mKernel.setArg(mNumArgs, 0u);
+  cl_err = mQueue.enqueueNDRangeKernel(
+    mKernel, cl::NullRange, cl::NDRange(size), cl::NDRange(mLws), &mPreviousEvents, nullptr);
+#endif
+  CL_CHECK_ERROR(cl_err, "enqueue probe kernel");
+  CL_CHECK_ERROR(mQueue.finish(), "finish probe kernel");
+}
+
+/**
+ * \brief Measures the input transfer, the launch latency and the throughput of the kernel, and
+ * the read back of the output of `size` work-items (from offset 0).
+ */
+void
+Device::probe(size_t size, uint outWorkitems, uint outPositions)
+{
+  if (mHost) {
+    return probeHost(size);
+  }
+  if (mSimulated) {
+    return probeSimulated(size);
+  }
+  using clock = std::chrono::steady_clock;
+  auto seconds = [](clock::time_point t1, clock::time_point t2) {
+    return std::chrono::duration<double>(t2 - t1).count();
+  };
+
+  CL_CHECK_ERROR(mQueue.finish(), "finish initial writes");
+  mProfile.id = mId;
+  mProfile.platform = mSelPlatform;
+  mProfile.device = mSelDevice;
+  mProfile.probeSize = size;
+
+  mProfile.writeBytes = 0;
+  for (auto& b : mInEclBuffers) {
+    mProfile.writeBytes += b.bytes();
+  }
+  auto t1 = clock::now();
+  writeBuffers();
+  CL_CHECK_ERROR(mQueue.finish(), "finish probe writes");
+  mProfile.writeSeconds = seconds(t1, clock::now());
+
+  enqueueProbeKernel(mLws); // first launch may include lazy compilation
+  t1 = clock::now();
+  enqueueProbeKernel(mLws);
+  mProfile.launchSeconds = seconds(t1, clock::now());
+  t1 = clock::now();
+  enqueueProbeKernel(size);
+  mProfile.kernelSeconds = seconds(t1, clock::now());
+
+  size_t outSize = outWorkitems * size / outPositions;
+  mProfile.readBytes = 0;
+  t1 = clock::now();
+  auto len = mOutEclBuffers.size();
+  for (uint i = 0; i < len; ++i) {
+    Buffer& b = mOutEclBuffers[i];
+    size_t sizeBytes = b.byBytes(outSize);
+    CL_CHECK_ERROR(
+      mQueue.enqueueReadBuffer(mOutBuffers[i], CL_TRUE, 0, sizeBytes, b.data(), nullptr, nullptr),
+      "probe read buffer " + to_string(i));
+    mProfile.readBytes += sizeBytes;
+  }
+  mProfile.readSeconds = seconds(t1, clock::now());
 }
 
 void
 Device::init()
 {
-  mTime = std::chrono::system_clock::now().time_since_epoch();
+  mTime = std::chrono::steady_clock::now();
   mInfoBuffer.reserve(128);
   saveDuration(ActionType::init);
   saveDurationOffset(ActionType::init);
+  if (mHost || mSimulated) { // without OpenCL
+    if (mHost) {
+      initHost();
+    }
+    if (mReactor != nullptr) { // the reactor thread only launches the chunks
+      auto launch = [this](size_t offset, size_t size, int queueIndex) {
+        launchWork(offset, size, queueIndex);
+      };
+      mLauncher = make_unique<Launcher>(launch, ECL_DEVICE_PIPELINE);
+    }
+    mRng.seed(mId);
+    saveDuration(ActionType::initKernel);
+    saveDurationOffset(ActionType::initKernel);
+    return;
+  }
 
   useRuntimeDiscovery();
+  initSubDevice();
   saveDuration(ActionType::useDiscovery);
   saveDurationOffset(ActionType::useDiscovery);
 
@@ -448,12 +1180,29 @@ Device::init()
   saveDuration(ActionType::initContext);
   initQueue();
   saveDuration(ActionType::initQueue);
-  initBuffers();
-  saveDuration(ActionType::initBuffers);
-  saveDurationOffset(ActionType::initBuffers);
   initKernel();
   saveDuration(ActionType::initKernel);
   saveDurationOffset(ActionType::initKernel);
+}
+
+/**
+ * \brief Second stage of the initialization, once the host data is ready.
+ *
+ * `init` only depends on the kernel, so it can overlap with the host filling the buffers.
+ */
+void
+Device::initData()
+{
+  if (mHost) { // computes on the host arrays
+    return;
+  }
+  if (mSimulated) {
+    return simulateWrite();
+  }
+  initBuffers();
+  initKernelArgs();
+  saveDuration(ActionType::initBuffers);
+  saveDurationOffset(ActionType::initBuffers);
   initEvents();
   writeBuffers();
   saveDuration(ActionType::writeBuffers);
@@ -480,6 +1229,31 @@ Device::initByIndex(uint selPlatform, uint selDevice)
   mDevice = devices.at(selDevice);
 }
 
+/**
+ * \brief With CPUs reserved for the host threads (`AffinityPolicy::setExcludeFromCpuDevices`), a
+ * CPU device is replaced by a sub-device without as many compute units.
+ */
+void
+Device::initSubDevice()
+{
+  if (mReservedCpus == 0 || mDevice.getInfo<CL_DEVICE_TYPE>() != CL_DEVICE_TYPE_CPU) {
+    return;
+  }
+  auto units = mDevice.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+  if (units <= mReservedCpus) {
+    throw runtime_error("the CPU device has " + to_string(units) +
+                        " compute units, not enough to reserve " + to_string(mReservedCpus));
+  }
+  cl_device_partition_property properties[] = { CL_DEVICE_PARTITION_BY_COUNTS,
+                                                static_cast<cl_device_partition_property>(
+                                                  units - mReservedCpus),
+                                                CL_DEVICE_PARTITION_BY_COUNTS_LIST_END,
+                                                0 };
+  vector<cl::Device> subDevices;
+  CL_CHECK_ERROR(mDevice.createSubDevices(properties, &subDevices), "CPU sub-device");
+  mDevice = subDevices.at(0);
+}
+
 void
 Device::initContext()
 {
@@ -495,7 +1269,8 @@ Device::initQueue()
   cl::Context& context = mContext;
   cl::Device& device = mDevice;
 
-  cl::CommandQueue queue(context, device, 0, &cl_err);
+  cl_command_queue_properties properties = mProfiling ? CL_QUEUE_PROFILING_ENABLE : 0;
+  cl::CommandQueue queue(context, device, properties, &cl_err);
   CL_CHECK_ERROR(cl_err, "CommandQueue queue");
   mQueue = move(queue);
 }
@@ -537,8 +1312,20 @@ Device::writeBuffers(bool /* dummy */)
   for (uint i = 0; i < len; ++i) {
     Buffer& b = mInEclBuffers[i];
     auto data = b.data();
+    if (mNodeLocalStaging) {
+      // new[] does not touch the pages, the copy (by threads inheriting the CPUs of this one)
+      // places them in the node of this thread. One per input, as the writes of a previous
+      // call (probe or run) completed before this one
+      if (mStagingBuffers.size() == i) {
+        mStagingBuffers.emplace_back(new char[b.bytes()]);
+      }
+      parallelCopy(mStagingBuffers[i].get(), data, b.bytes(), static_cast<int>(mPlacement.size()));
+      data = mStagingBuffers[i].get();
+    }
     CL_CHECK_ERROR(mQueue.enqueueWriteBuffer(
       mInBuffers[i], CL_FALSE, 0, b.bytes(), data, NULL, &(mPreviousEvents.data()[i])));
+    saveCommand(CommandType::Write, mPreviousEvents[i], i, b.bytes());
+    saveTransfer(CommandType::Write, i, b.bytes());
   }
 }
 
@@ -576,6 +1363,15 @@ Device::initKernel()
   cl::Kernel kernel(program, mKernelStr.c_str(), &cl_err);
   CL_CHECK_ERROR(cl_err, "kernel");
 
+  mKernel = move(kernel);
+}
+
+void
+Device::initKernelArgs()
+{
+  cl_int cl_err;
+  cl::Kernel& kernel = mKernel;
+
   auto len = mArgIndex.size();
   auto unassigned = mInBuffersPtr.size();
   for (uint i = 0; i < len; ++i) {
@@ -622,6 +1418,13 @@ Device::initKernel()
       void* ptr = mArgPtr[i];
       cl_err = kernel.setArg((cl_uint)i, bytes, ptr);
       CL_CHECK_ERROR(cl_err, "kernel arg " + to_string(i));
+    } else if (type == ArgType::ExitFlag) {
+      mExitFlag = 0;
+      mExitFlagBuffer = cl::Buffer(
+        mContext, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(cl_int), &mExitFlag, &cl_err);
+      CL_CHECK_ERROR(cl_err, "exit flag buffer");
+      cl_err = kernel.setArg(index, mExitFlagBuffer);
+      CL_CHECK_ERROR(cl_err, "kernel arg exit flag " + to_string(i));
     } else { // ArgType::LocalAlloc
       size_t bytes = mArgBytes[i];
       void* ptr = mArgPtr[i];
@@ -630,8 +1433,6 @@ Device::initKernel()
       CL_CHECK_ERROR(cl_err, "kernel arg " + to_string(i));
     }
   }
-
-  mKernel = move(kernel);
 }
 
 void
@@ -640,8 +1441,178 @@ Device::setLWS(size_t lws)
   mLws = lws;
 }
 
+/**
+ * \brief Creates the queue with CL_QUEUE_PROFILING_ENABLE, recording the QUEUED, SUBMIT, START
+ * and END of every transfer and kernel. Should be set before the device initialization.
+ */
+void
+Device::setProfiling(bool profiling)
+{
+  mProfiling = profiling;
+}
+
+void
+Device::saveCommand(CommandType type, const cl::Event& event, int buffer, size_t bytes)
+{
+  if (mProfiling) {
+    auto t2 = std::chrono::steady_clock::now();
+    CommandProfile profile;
+    profile.type = type;
+    profile.enqueued =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - mTimeInit).count();
+    profile.chunk = type == CommandType::Write ? -1 : static_cast<int>(mWorks);
+    profile.buffer = buffer;
+    profile.bytes = bytes;
+    mCommandEvents.push_back(make_tuple(profile, event));
+  }
+}
+
+/**
+ * \brief Counts the bytes moved by the device (writes are host to device, reads device to host).
+ * A `buffer` of -1 is only counted in the device totals (exit flag).
+ */
 void
-Device::setTimeInit(std::chrono::duration<double> timeInit)
+Device::saveTransfer(CommandType type, int buffer, size_t bytes)
+{
+  if (type == CommandType::Write) {
+    mWrites++;
+    mWriteBytes += bytes;
+    mMetrics->writeBytes.fetch_add(bytes, std::memory_order_relaxed);
+    if (buffer >= 0) {
+      mInEclBuffers[buffer].addTransfer(bytes);
+    }
+  } else {
+    mReads++;
+    mReadBytes += bytes;
+    mMetrics->readBytes.fetch_add(bytes, std::memory_order_relaxed);
+    if (buffer >= 0) {
+      mOutEclBuffers[buffer].addTransfer(bytes);
+    }
+  }
+}
+
+/**
+ * \brief Queries the profiling info of the commands, once they are completed.
+ */
+void
+Device::collectProfiling()
+{
+  mCommandProfiles.reserve(mCommandProfiles.size() + mCommandEvents.size());
+  for (auto& command : mCommandEvents) {
+    cl::Event& event = std::get<1>(command);
+    CommandProfile profile = std::get<0>(command);
+    cl_int errors[4];
+    profile.queued = event.getProfilingInfo<CL_PROFILING_COMMAND_QUEUED>(&errors[0]);
+    profile.submit = event.getProfilingInfo<CL_PROFILING_COMMAND_SUBMIT>(&errors[1]);
+    profile.start = event.getProfilingInfo<CL_PROFILING_COMMAND_START>(&errors[2]);
+    profile.end = event.getProfilingInfo<CL_PROFILING_COMMAND_END>(&errors[3]);
+    if (std::all_of(errors, errors + 4, [](cl_int err) { return err == CL_SUCCESS; })) {
+      mCommandProfiles.push_back(profile);
+      if (profile.buffer >= 0) {
+        auto& buffers = profile.type == CommandType::Write ? mInEclBuffers : mOutEclBuffers;
+        buffers[profile.buffer].addTransferTime(profile.end - profile.start);
+      }
+    }
+  }
+  mCommandEvents.clear();
+}
+
+/**
+ * \brief Kernel and transfer times (START to END) and the host overhead: the time the device
+ * spent without executing commands between the first command queued and the last completed.
+ */
+void
+Device::fillCommandTimes(DeviceStats& stats)
+{
+  cl_ulong times[3] = { 0, 0, 0 };
+  cl_ulong first = mCommandProfiles.empty() ? 0 : mCommandProfiles[0].queued;
+  cl_ulong last = mCommandProfiles.empty() ? 0 : mCommandProfiles[0].end;
+  for (auto& profile : mCommandProfiles) {
+    times[static_cast<int>(profile.type)] += profile.end - profile.start;
+    first = std::min(first, profile.queued);
+    last = std::max(last, profile.end);
+  }
+  cl_ulong busy = times[0] + times[1] + times[2];
+  cl_ulong span = last - first;
+  stats.kernel_ns = times[static_cast<int>(CommandType::Kernel)];
+  stats.write_ns = times[static_cast<int>(CommandType::Write)];
+  stats.read_ns = times[static_cast<int>(CommandType::Read)];
+  stats.overhead_ns = span > busy ? span - busy : 0;
+  stats.write_gbps = gbps(stats.writeBytes, stats.write_ns);
+  stats.read_gbps = gbps(stats.readBytes, stats.read_ns);
+}
+
+void
+Device::printProfiling()
+{
+  if (mCommandProfiles.empty()) {
+    return;
+  }
+  DeviceStats stats;
+  fillCommandTimes(stats);
+  cout << "profiling (" << mCommandProfiles.size() << " commands):\n";
+  Inspector::printDuration("kernel", stats.kernel_ns);
+  Inspector::printDuration("write", stats.write_ns);
+  Inspector::printDuration("read", stats.read_ns);
+  Inspector::printDuration("host overhead", stats.overhead_ns);
+  cout << " write bandwidth: " << gbps(mWriteBytes, stats.write_ns) << " GB/s\n";
+  cout << " read bandwidth: " << gbps(mReadBytes, stats.read_ns) << " GB/s\n";
+}
+
+DeviceStats
+Device::getStats()
+{
+  DeviceStats stats;
+  stats.id = mId;
+  stats.platform = mSelPlatform;
+  stats.device = mSelDevice;
+  stats.quarantined = isQuarantined();
+  stats.failure = mFailure;
+  stats.host = mHost;
+  stats.simulated = mSimulated;
+  stats.cpus = mPlacement;
+  stats.works = mWorks;
+  stats.worksSize = mWorksSize;
+  stats.eventsDropped = mDurationActions.dropped() + mCallbackActions.dropped();
+#if ECL_SAVE_CHUNKS
+  stats.eventsDropped += mChunks.dropped();
+#endif
+#if ECL_HANDOFF_PROFILING
+  stats.eventsDropped += mHandOffs.dropped();
+#endif
+  stats.phases = phasesFromOffsets(mDurationOffsetActions.toVector());
+  stats.writes = mWrites;
+  stats.writeBytes = mWriteBytes;
+  stats.reads = mReads;
+  stats.readBytes = mReadBytes;
+  fillCommandTimes(stats);
+  addBufferStats(stats, "in", mInEclBuffers);
+  addBufferStats(stats, "out", mOutEclBuffers);
+#if ECL_SAVE_CHUNKS
+  // the commands and the chunks know their work (failed works save no chunk)
+  vector<size_t> kernelNs(mWorks + 1, 0);
+  vector<size_t> transferNs(mWorks + 1, 0);
+  for (auto& profile : mCommandProfiles) {
+    if (profile.chunk >= 0 && static_cast<size_t>(profile.chunk) <= mWorks) {
+      auto& times = profile.type == CommandType::Kernel ? kernelNs : transferNs;
+      times[profile.chunk] += profile.end - profile.start;
+    }
+  }
+  stats.chunks.reserve(mChunks.size());
+  for (auto& chunk : mChunks.toVector()) {
+    stats.chunks.push_back({ chunk.offset,
+                             chunk.size,
+                             chunk.ts_ns,
+                             chunk.duration_ns,
+                             kernelNs[chunk.work],
+                             transferNs[chunk.work] });
+  }
+#endif
+  return stats;
+}
+
+void
+Device::setTimeInit(std::chrono::steady_clock::time_point timeInit)
 {
   mTimeInit = timeInit;
 }
@@ -659,6 +1630,19 @@ Device::initEvents()
 void
 Device::showInfo()
 {
+  if (mHost) {
+    cout << "Selected device: host (" << (mPool ? mPool->size() : mHostThreads) << " threads)\n";
+    return;
+  }
+  if (mSimulated) {
+    cout << "Selected device: simulated " << mModel.name << " (" << mModel.itemsPerSecond
+         << " items/s)\n";
+    return;
+  }
+  if (mDevice() == nullptr) {
+    cout << "Selected platform.device: " << mSelPlatform << "." << mSelDevice << " (unavailable)\n";
+    return;
+  }
   CL_CHECK_ERROR(mPlatform.getInfo(CL_PLATFORM_NAME, &mInfoBuffer));
   if (mInfoBuffer.size() > 2)
     mInfoBuffer.erase(mInfoBuffer.size() - 1, 1);
@@ -680,4 +1664,10 @@ Device::setRuntime(Runtime* runtime)
   mRuntime = runtime;
 }
 
+void
+Device::setReactor(Reactor* reactor)
+{
+  mReactor = reactor;
+}
+
 } // namespace ecl
@@ -0,0 +1,121 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#include "HostOps.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "config.hpp"
+
+namespace ecl {
+
+#ifdef _OPENMP
+static int
+team(int threads)
+{
+  return threads > 0 ? threads : omp_get_max_threads();
+}
+#endif
+
+template<typename T>
+void
+parallelFill(T* data, size_t size, T value, int threads)
+{
+#ifdef _OPENMP
+#pragma omp parallel for simd schedule(static) num_threads(team(threads))                          \
+  if (size * sizeof(T) >= ECL_HOST_PARALLEL_BYTES)
+#endif
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = value;
+  }
+}
+
+void
+parallelCopy(void* dst, const void* src, size_t bytes, int threads)
+{
+#ifdef _OPENMP
+  if (bytes >= ECL_HOST_PARALLEL_BYTES) {
+#pragma omp parallel num_threads(team(threads))
+    {
+      size_t parts = omp_get_num_threads();
+      size_t part = (bytes + parts - 1) / parts;
+      size_t begin = std::min(bytes, omp_get_thread_num() * part);
+      size_t end = std::min(bytes, begin + part);
+      std::memcpy(static_cast<char*>(dst) + begin, static_cast<const char*>(src) + begin,
+                  end - begin);
+    }
+    return;
+  }
+#else
+  (void)threads;
+#endif
+  std::memcpy(dst, src, bytes);
+}
+
+Comparison
+parallelCompareRanges(size_t size,
+                      size_t bytes,
+                      const std::function<Comparison(size_t, size_t)>& compare,
+                      int threads)
+{
+  Comparison total = { 0, std::numeric_limits<size_t>::max(), 0.0 };
+#ifdef _OPENMP
+  if (bytes >= ECL_HOST_PARALLEL_BYTES) {
+#pragma omp parallel num_threads(team(threads))
+    {
+      size_t parts = omp_get_num_threads();
+      size_t part = (size + parts - 1) / parts;
+      size_t begin = std::min(size, omp_get_thread_num() * part);
+      size_t end = std::min(size, begin + part);
+      auto c = compare(begin, end - begin);
+#pragma omp critical
+      {
+        total.mismatches += c.mismatches;
+        total.first = std::min(total.first, c.first);
+        total.maxError = std::max(total.maxError, c.maxError);
+      }
+    }
+  } else {
+    total = compare(0, size);
+  }
+#else
+  (void)bytes;
+  (void)threads;
+  total = compare(0, size);
+#endif
+  if (total.mismatches == 0) {
+    total.first = size;
+  }
+  return total;
+}
+
+template<typename T>
+Comparison
+parallelCompare(const T* actual, const T* expected, size_t size, double tolerance, int threads)
+{
+  auto item = [expected](size_t i) { return expected[i]; };
+  auto compare = [&](size_t offset, size_t size) {
+    return compareRange(actual, item, offset, size, tolerance);
+  };
+  return parallelCompareRanges(size, size * sizeof(T), compare, threads);
+}
+
+#define ECL_HOST_OPS(T)                                                                            \
+  template void parallelFill<T>(T*, size_t, T, int);                                              \
+  template Comparison parallelCompare<T>(const T*, const T*, size_t, double, int);
+
+ECL_HOST_OPS(int)
+ECL_HOST_OPS(uint)
+ECL_HOST_OPS(float)
+ECL_HOST_OPS(double)
+
+} // namespace ecl
@@ -5,60 +5,82 @@
  */
 #include "Inspector.hpp"
 
+#include <cstdio>
+
 namespace ecl {
 
+string
+Inspector::toMs(size_t ns)
+{
+  char ms[32];
+  snprintf(ms, sizeof(ms), "%.3f", ns / 1e6);
+  return ms;
+}
+
 void
-Inspector::printActionTypeDuration(ActionType action, size_t d)
+Inspector::printDuration(const string& name, size_t ns)
+{
+  cout << " " << name << ": " << toMs(ns) << " ms.\n";
+}
+
+string
+Inspector::actionTypeName(ActionType action)
 {
   switch (action) {
     case ActionType::init:
-      cout << " init: " << d << " ms.\n";
-      break;
+      return "init";
     case ActionType::useDiscovery:
-      cout << " useDiscovery: " << d << " ms.\n";
-      break;
+      return "useDiscovery";
     case ActionType::initDiscovery:
-      cout << " initDiscovery: " << d << " ms.\n";
-      break;
+      return "initDiscovery";
     case ActionType::initContext:
-      cout << " initContext: " << d << " ms.\n";
-      break;
+      return "initContext";
     case ActionType::initQueue:
-      cout << " initQueue: " << d << " ms.\n";
-      break;
+      return "initQueue";
     case ActionType::initBuffers:
-      cout << " initBuffers: " << d << " ms.\n";
-      break;
+      return "initBuffers";
     case ActionType::initKernel:
-      cout << " initKernel: " << d << " ms.\n";
-      break;
+      return "initKernel";
     case ActionType::writeBuffersDummy:
-      cout << " writeBuffersDummy: " << d << " ms.\n";
-      break;
+      return "writeBuffersDummy";
     case ActionType::writeBuffers:
-      cout << " writeBuffers: " << d << " ms.\n";
-      break;
+      return "writeBuffers";
     case ActionType::deviceStart:
-      cout << " deviceStart: " << d << " ms.\n";
-      break;
+      return "deviceStart";
     case ActionType::schedulerStart:
-      cout << " schedulerStart: " << d << " ms.\n";
-      break;
+      return "schedulerStart";
     case ActionType::deviceReady:
-      cout << " deviceReady: " << d << " ms.\n";
-      break;
+      return "deviceReady";
     case ActionType::deviceRun:
-      cout << " deviceRun: " << d << " ms.\n";
-      break;
+      return "deviceRun";
     case ActionType::completeWork:
-      cout << " completeWork: " << d << " ms.\n";
-      break;
+      return "completeWork";
     case ActionType::deviceEnd:
-      cout << " deviceEnd: " << d << " ms.\n";
-      break;
+      return "deviceEnd";
     case ActionType::schedulerEnd:
-      cout << " schedulerEnd: " << d << " ms.\n";
-      break;
+      return "schedulerEnd";
+    case ActionType::dataReady:
+      return "dataReady";
+  }
+  return "unknown";
+}
+
+void
+Inspector::printActionTypeDuration(ActionType action, size_t ns)
+{
+  printDuration(actionTypeName(action), ns);
+}
+
+void
+Inspector::printRecoveries(const vector<Recovery>& recoveries)
+{
+  for (auto& r : recoveries) {
+    cout << " recovered " << r.offset << "+" << r.size << " from device " << r.from;
+    if (r.to < 0) {
+      cout << ": lost (no device survived)\n";
+    } else {
+      cout << " to device " << r.to << "\n";
+    }
   }
 }
 
@@ -0,0 +1,53 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#include "Launcher.hpp"
+
+namespace ecl {
+
+Launcher::Launcher(Task task, size_t capacity)
+  : mTask(move(task))
+  , mLaunches(capacity)
+  , mStop(false)
+  , mSema(1)
+{
+  mThread = thread(&Launcher::run, this);
+}
+
+Launcher::~Launcher()
+{
+  mStop.store(true, std::memory_order_release);
+  mSema.notify(1);
+  mThread.join();
+}
+
+//! \brief Beyond the capacity (eg. the chunks of a replay), it waits for the launcher to run one.
+void
+Launcher::submit(size_t offset, size_t size, int queueIndex)
+{
+  while (!mLaunches.push({ offset, size, queueIndex })) {
+    std::this_thread::yield();
+  }
+  mSema.notify(1);
+}
+
+//! \brief A wake up without launches is the one of the destructor.
+void
+Launcher::run()
+{
+  for (;;) {
+    mSema.wait(1);
+    Launch launch;
+    while (!mLaunches.pop(launch)) {
+      if (mStop.load(std::memory_order_acquire)) {
+        return;
+      }
+      std::this_thread::yield(); // claimed, not published yet
+    }
+    mTask(launch.offset, launch.size, launch.queueIndex);
+  }
+}
+
+} // namespace ecl
@@ -0,0 +1,281 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#include "Metrics.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Runtime.hpp"
+
+namespace ecl {
+
+static const string SOCKET_PREFIX = "unix:";
+// the socket is polled in slices, so the exporter stops promptly
+static const int POLL_SLICE_MS = 100;
+
+static void
+addCounters(DeviceCounters& total, const DeviceCounters& counters)
+{
+  total.chunks += counters.chunks;
+  total.items += counters.items;
+  total.writeBytes += counters.writeBytes;
+  total.readBytes += counters.readBytes;
+  total.waitNs += counters.waitNs;
+}
+
+static void
+writeHeader(std::ostringstream& os, const string& name, const string& type, const string& help)
+{
+  os << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+}
+
+MetricsExporter::MetricsExporter(const string& target, std::chrono::milliseconds period)
+  : mTarget(target)
+  , mListenFd(-1)
+  , mPeriod(period)
+  , mLastRender(std::chrono::steady_clock::now())
+  , mRuns(0)
+  , mStop(false)
+{
+  if (mTarget.compare(0, SOCKET_PREFIX.size(), SOCKET_PREFIX) == 0) {
+    mSocketPath = mTarget.substr(SOCKET_PREFIX.size());
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (mSocketPath.empty() || mSocketPath.size() >= sizeof(addr.sun_path)) {
+      throw std::runtime_error("invalid metrics socket path: " + mSocketPath);
+    }
+    strncpy(addr.sun_path, mSocketPath.c_str(), sizeof(addr.sun_path) - 1);
+    mListenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (mListenFd < 0) {
+      throw std::runtime_error("metrics socket: " + string(strerror(errno)));
+    }
+    unlink(mSocketPath.c_str()); // stale socket of a previous process
+    if (bind(mListenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        listen(mListenFd, 8) < 0) {
+      auto error = string(strerror(errno));
+      close(mListenFd);
+      throw std::runtime_error("metrics socket " + mSocketPath + ": " + error);
+    }
+  }
+  publish();
+  mThread = std::thread(&MetricsExporter::run, this);
+}
+
+MetricsExporter::~MetricsExporter()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutexStop);
+    mStop = true;
+  }
+  mCondStop.notify_one();
+  if (mThread.joinable()) {
+    mThread.join();
+  }
+  if (mListenFd >= 0) {
+    close(mListenFd);
+    unlink(mSocketPath.c_str());
+  } else {
+    publish(); // the final values
+  }
+}
+
+void
+MetricsExporter::attach(Runtime* runtime)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mRuntimes.push_back(runtime);
+}
+
+void
+MetricsExporter::detach(Runtime* runtime)
+{
+  auto snapshot = runtime->metrics();
+  std::lock_guard<std::mutex> lock(mMutex);
+  for (auto& counters : snapshot.devices) {
+    auto it = mDetached.find(counters.id);
+    if (it == mDetached.end()) {
+      mDetached[counters.id] = counters;
+    } else {
+      addCounters(it->second, counters);
+    }
+  }
+  mRuntimes.erase(std::remove(begin(mRuntimes), end(mRuntimes), runtime), end(mRuntimes));
+  mRuns++;
+}
+
+string
+MetricsExporter::render()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  auto totals = mDetached;
+  size_t queueDepth = 0;
+  for (auto runtime : mRuntimes) {
+    auto snapshot = runtime->metrics();
+    queueDepth += snapshot.queueDepth;
+    for (auto& counters : snapshot.devices) {
+      auto it = totals.find(counters.id);
+      if (it == totals.end()) {
+        totals[counters.id] = counters;
+      } else {
+        addCounters(it->second, counters);
+      }
+    }
+  }
+  auto now = std::chrono::steady_clock::now();
+  double seconds = std::chrono::duration<double>(now - mLastRender).count();
+  mLastRender = now;
+
+  std::ostringstream os;
+  writeHeader(os, "enginecl_runs_total", "counter", "Runs finished.");
+  os << "enginecl_runs_total " << mRuns << "\n";
+  writeHeader(os, "enginecl_running", "gauge", "Runs in progress.");
+  os << "enginecl_running " << mRuntimes.size() << "\n";
+  writeHeader(os,
+              "enginecl_queue_depth",
+              "gauge",
+              "Chunks dispatched and not completed, plus the requests not served.");
+  os << "enginecl_queue_depth " << queueDepth << "\n";
+
+  writeHeader(os, "enginecl_chunks_total", "counter", "Chunks computed by the device.");
+  for (auto& t : totals) {
+    os << "enginecl_chunks_total{device=\"" << t.first << "\"} " << t.second.chunks << "\n";
+  }
+  writeHeader(os, "enginecl_items_total", "counter", "Work-items computed by the device.");
+  for (auto& t : totals) {
+    os << "enginecl_items_total{device=\"" << t.first << "\"} " << t.second.items << "\n";
+  }
+  writeHeader(
+    os, "enginecl_items_per_second", "gauge", "Work-items computed since the previous export.");
+  for (auto& t : totals) {
+    auto& last = mLastItems[t.first];
+    auto rate = seconds > 0.0 && t.second.items >= last ? (t.second.items - last) / seconds : 0.0;
+    os << "enginecl_items_per_second{device=\"" << t.first << "\"} " << rate << "\n";
+    last = t.second.items;
+  }
+  writeHeader(
+    os, "enginecl_transfer_bytes_total", "counter", "Bytes transferred by the device.");
+  for (auto& t : totals) {
+    os << "enginecl_transfer_bytes_total{device=\"" << t.first
+       << "\",direction=\"host_to_device\"} " << t.second.writeBytes << "\n";
+    os << "enginecl_transfer_bytes_total{device=\"" << t.first
+       << "\",direction=\"device_to_host\"} " << t.second.readBytes << "\n";
+  }
+  writeHeader(os,
+              "enginecl_scheduler_wait_seconds_total",
+              "counter",
+              "Time the device waited for work from the scheduler.");
+  for (auto& t : totals) {
+    os << "enginecl_scheduler_wait_seconds_total{device=\"" << t.first << "\"} "
+       << t.second.waitNs / 1e9 << "\n";
+  }
+  return os.str();
+}
+
+void
+MetricsExporter::publish()
+{
+  auto text = render();
+  std::lock_guard<std::mutex> lock(mMutex);
+  if (mListenFd >= 0) {
+    mText = move(text);
+  } else {
+    writeFile(text);
+  }
+}
+
+/**
+ * \brief Written aside and renamed, so readers never see a partial file. Errors are ignored: the
+ * metrics are best-effort and must not stop the runtime.
+ */
+void
+MetricsExporter::writeFile(const string& text)
+{
+  auto tmp = mTarget + ".tmp";
+  {
+    std::ofstream file(tmp, std::ios::trunc);
+    file << text;
+    if (!file) {
+      return;
+    }
+  }
+  std::rename(tmp.c_str(), mTarget.c_str());
+}
+
+void
+MetricsExporter::serve(int fd)
+{
+  int client = accept(fd, nullptr, nullptr);
+  if (client < 0) {
+    return;
+  }
+  // consumes the request (if any), closing with unread data would reset the connection
+  pollfd request = { client, POLLIN, 0 };
+  if (poll(&request, 1, POLL_SLICE_MS) > 0) {
+    char buffer[1024];
+    recv(client, buffer, sizeof(buffer), MSG_DONTWAIT);
+  }
+  string text;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    text = mText;
+  }
+  string response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                    "Content-Length: " +
+                    std::to_string(text.size()) + "\r\n\r\n" + text;
+  size_t sent = 0;
+  while (sent < response.size()) {
+    auto n = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+    if (n <= 0) {
+      break;
+    }
+    sent += n;
+  }
+  close(client);
+}
+
+void
+MetricsExporter::run()
+{
+  auto next = std::chrono::steady_clock::now() + mPeriod;
+  std::unique_lock<std::mutex> lock(mMutexStop);
+  while (!mStop) {
+    auto now = std::chrono::steady_clock::now();
+    if (now >= next) {
+      lock.unlock();
+      publish();
+      lock.lock();
+      next += mPeriod;
+      if (next < now) { // slower than the period
+        next = now + mPeriod;
+      }
+      continue;
+    }
+    if (mListenFd < 0) {
+      mCondStop.wait_until(lock, next, [&] { return mStop; });
+      continue;
+    }
+    lock.unlock();
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(next - now).count();
+    pollfd listen = { mListenFd, POLLIN, 0 };
+    if (poll(&listen, 1, std::min<int>(remaining + 1, POLL_SLICE_MS)) > 0) {
+      serve(mListenFd);
+    }
+    lock.lock();
+  }
+}
+
+} // namespace ecl
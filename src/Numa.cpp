@@ -0,0 +1,112 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#include "Numa.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "Affinity.hpp"
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using std::string;
+using std::to_string;
+
+namespace ecl {
+
+vector<int>
+numaNodes()
+{
+  std::ifstream is("/sys/devices/system/node/has_memory");
+  string list;
+  if (!std::getline(is, list)) {
+    return { 0 };
+  }
+  auto nodes = parseCpuList(list); // same syntax
+  return nodes.empty() ? vector<int>{ 0 } : nodes;
+}
+
+int
+cpuNode(int cpu)
+{
+  for (auto node : numaNodes()) {
+    std::ifstream is("/sys/devices/system/node/node" + to_string(node) + "/cpulist");
+    string list;
+    if (std::getline(is, list)) {
+      for (auto nodeCpu : parseCpuList(list)) {
+        if (nodeCpu == cpu) {
+          return node;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+int
+cpusNode(const vector<int>& cpus)
+{
+  int node = -1;
+  for (auto cpu : cpus) {
+    auto other = cpuNode(cpu);
+    if (node >= 0 && other != node) {
+      return -1;
+    }
+    node = other;
+  }
+  return node;
+}
+
+void
+placeMemory(void* ptr, size_t bytes, const NumaPlacement& placement)
+{
+  if (placement.policy == NumaPlacement::Policy::Default || bytes == 0) {
+    return;
+  }
+#ifdef __linux__
+  auto nodes = placement.nodes.empty() ? numaNodes() : placement.nodes;
+  if (placement.policy == NumaPlacement::Policy::Bind && nodes.size() != 1) {
+    throw std::runtime_error("a NUMA binding requires a single node");
+  }
+  const size_t bitsPerWord = sizeof(unsigned long) * 8;
+  vector<unsigned long> mask(1);
+  for (auto node : nodes) {
+    if (node < 0) {
+      throw std::runtime_error("invalid NUMA node " + to_string(node));
+    }
+    mask.resize(std::max(mask.size(), node / bitsPerWord + 1));
+    mask[node / bitsPerWord] |= 1ul << (node % bitsPerWord);
+  }
+  // whole pages inside the range, so the neighbour allocations keep their placement
+  auto page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  auto begin = reinterpret_cast<uintptr_t>(ptr);
+  auto first = (begin + page - 1) / page * page;
+  auto last = (begin + bytes) / page * page;
+  if (last <= first) {
+    return;
+  }
+  int mode = placement.policy == NumaPlacement::Policy::Bind ? MPOL_BIND : MPOL_INTERLEAVE;
+  auto maxNode = mask.size() * bitsPerWord + 1; // the kernel reads maxnode - 1 bits
+  if (syscall(SYS_mbind, first, last - first, mode, mask.data(), maxNode, MPOL_MF_MOVE) != 0) {
+    throw std::runtime_error(string("cannot place the memory in the NUMA nodes ") +
+                             formatCpuList(nodes) + ": " + std::strerror(errno));
+  }
+#else
+  (void)ptr;
+  throw std::runtime_error("NUMA placement is not supported in this platform");
+#endif
+}
+
+} // namespace ecl
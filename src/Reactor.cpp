@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#include "Reactor.hpp"
+
+#include <exception>
+
+#include "Device.hpp"
+
+namespace ecl {
+
+Reactor::Reactor(vector<Device*> devices)
+  : mDevices(move(devices))
+  , mWakes(new std::atomic<uint>[mDevices.size()]())
+  , mReady(mDevices.size())
+  , mSemaReady(1)
+{}
+
+Reactor::~Reactor()
+{
+  if (mThread.joinable()) {
+    mThread.join();
+  }
+}
+
+void
+Reactor::start()
+{
+  mThread = thread(&Reactor::run, this);
+}
+
+//! \brief Only the first wake up queues the device, the next ones are counted until it is run.
+void
+Reactor::notify(int id)
+{
+  if (mWakes[id].fetch_add(1, std::memory_order_acq_rel) > 0) {
+    return;
+  }
+  while (!mReady.push(id)) { // queued at most once per device, so it is not full
+    std::this_thread::yield();
+  }
+  mSemaReady.notify(1);
+}
+
+/**
+ * \brief The stages of `device_thread_func` for every device, and then the work of the devices
+ * woken until all of them are done (the wake ups of a device already done are ignored).
+ */
+void
+Reactor::run()
+{
+  for (auto device : mDevices) {
+    try {
+      device->applyAffinity();
+    } catch (std::exception& e) {
+      device->quarantine(e.what());
+    }
+  }
+  for (auto device : mDevices) {
+    device->initStage();
+  }
+  for (auto device : mDevices) {
+    if (!device->dataStage()) {
+      return; // the runtime released every device
+    }
+  }
+  vector<bool> done(mDevices.size(), true);
+  size_t active = 0;
+  for (size_t id = 0; id < mDevices.size(); ++id) {
+    if (mDevices[id]->runStage()) {
+      done[id] = false;
+      active++;
+    }
+  }
+  while (active > 0) {
+    mSemaReady.wait(1);
+    uint id;
+    while (!mReady.pop(id)) { // claimed, not published yet
+      std::this_thread::yield();
+    }
+    // the wakes after the exchange queue the device again
+    for (auto wakes = mWakes[id].exchange(0, std::memory_order_acq_rel); wakes > 0; --wakes) {
+      if (!done[id] && !mDevices[id]->workStep()) {
+        done[id] = true;
+        active--;
+      }
+    }
+  }
+}
+
+} // namespace ecl
@@ -8,81 +8,390 @@
 #include "Device.hpp"
 #include "Inspector.hpp"
 #include "Scheduler.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <cstring>
 
 namespace ecl {
 
+/**
+ * \brief The first action is an instant, each next one a span from the previous action (as the
+ * duration increments of printStats).
+ */
+static void
+addPhases(Trace& trace, int track, const vector<PhaseStats>& phases)
+{
+  auto first = true;
+  for (auto& phase : phases) {
+    if (first) {
+      trace.addInstant(track, phase.name, "phase", phase.offset_ns);
+      first = false;
+    } else {
+      trace.addSpan(
+        track, phase.name, "phase", phase.offset_ns - phase.duration_ns, phase.duration_ns);
+    }
+  }
+}
+
+#if ECL_HANDOFF_PROFILING
+/**
+ * \brief Latency of each hand-off step since the previous one and of the whole gap. A step before
+ * the previous one (the scheduler was already awake) counts as 0.
+ */
+static vector<LatencyStats>
+handOffLatencies(vector<Device>& devices)
+{
+  const char* names[] = { "callback", "scheduler_wake", "dispatch", "device_wake", "launch" };
+  const int steps = static_cast<int>(HandOffStep::Launched) + 1;
+  vector<vector<size_t>> samples(steps);
+  for (auto& device : devices) {
+    for (auto& handOff : device.getHandOffs()) {
+      auto completed = handOff.steps[0];
+      auto previous = completed;
+      for (int i = 1; i < steps; ++i) {
+        auto ts = std::max(handOff.steps[i], previous);
+        samples[i - 1].push_back(ts - previous);
+        previous = ts;
+      }
+      samples[steps - 1].push_back(previous - completed);
+    }
+  }
+  vector<LatencyStats> latencies;
+  for (int i = 0; i < steps - 1; ++i) {
+    latencies.push_back(latencyStats(names[i], move(samples[i])));
+  }
+  latencies.push_back(latencyStats("gap", move(samples[steps - 1])));
+  return latencies;
+}
+#endif
+
+static string
+statusName(RunStatus status)
+{
+  switch (status) {
+    case RunStatus::Completed:
+      return "completed";
+    case RunStatus::Cancelled:
+      return "cancelled";
+    case RunStatus::DeadlineExceeded:
+      return "deadline exceeded";
+    case RunStatus::EarlyExit:
+      return "early exit";
+  }
+  return "unknown";
+}
+
+static string
+rangeArgs(size_t offset, size_t size)
+{
+  return "\"offset\":" + to_string(offset) + ",\"size\":" + to_string(size);
+}
+
 Runtime::Runtime(vector<Device>&& devices,
                  NDRange gws,
                  size_t lws,
                  uint out_workitems,
                  uint out_positions)
   : mDevices(move(devices))
+  , mScheduler(nullptr)
+  , mReactorMode(false)
   , mGws(gws)
   , mLws(lws)
   , mOutWorkitems(out_workitems)
   , mOutPositions(out_positions)
+  , mPrepared(false)
+  , mStarted(false)
+  , mRunning(false)
+  , mStatus(RunStatus::Completed)
+  , mHasDeadline(false)
+  , mBaselineNs(0)
+  , mMetrics(nullptr)
+  , mHasExitRange(false)
+  , mCalibrating(false)
+  , mProbeSize(0)
   , mSemaAllReady(mDevices.size())
+  , mDurationActions(64)
+  , mDurationOffsetActions(64)
+  , mHasHostKernel(false)
 {
   mBarrier = make_shared<Semaphore>(mDevices.size());
   mSemaReady = make_unique<Semaphore>(1);
 
-  mMutexDuration = new mutex();
-  mTimeInit = std::chrono::system_clock::now().time_since_epoch();
-  mTime = std::chrono::system_clock::now().time_since_epoch();
-  mDurationActions.reserve(2);       // NOTE: improve
-  mDurationOffsetActions.reserve(2); // the reserve
-  for (auto& device : devices) {
+  mTimeInit = std::chrono::steady_clock::now();
+  mTime = std::chrono::steady_clock::now();
+  for (auto& device : mDevices) {
     device.setTimeInit(mTimeInit);
   }
 }
 
+/**
+ * \brief A runtime prepared but not run (or calibrated) releases the threads of its devices, that
+ * still wait for the data, so they can be joined.
+ */
+Runtime::~Runtime()
+{
+  if (mPrepared && !mStarted) {
+    for (auto& device : mDevices) {
+      device.release();
+    }
+  }
+}
+
 void
 Runtime::saveDuration(ActionType action)
 {
-  lock_guard<mutex> lock(*mMutexDuration);
-  auto t2 = std::chrono::system_clock::now().time_since_epoch();
-  size_t diff_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - mTime).count();
-  mDurationActions.push_back(make_tuple(diff_ms, action));
+  auto t2 = std::chrono::steady_clock::now();
+  size_t diff_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - mTime).count();
+  mDurationActions.push(make_tuple(diff_ns, action));
   mTime = t2;
 }
 
 void
 Runtime::saveDurationOffset(ActionType action)
 {
-  lock_guard<mutex> lock(*mMutexDuration);
-  auto t2 = std::chrono::system_clock::now().time_since_epoch();
-  size_t diff_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - mTimeInit).count();
-  mDurationOffsetActions.push_back(make_tuple(diff_ms, action));
+  auto t2 = std::chrono::steady_clock::now();
+  size_t diff_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - mTimeInit).count();
+  mDurationOffsetActions.push(make_tuple(diff_ns, action));
 }
 
 void
 Runtime::printStats()
 {
   cout << "Kernel: " << mKernel << "\n";
-  cout << "Runtime init timestamp: " << std::fixed << (long)mTimeInit.count() << "\n";
+  cout << "Runtime init timestamp: " << mTimeInit.time_since_epoch().count() << " ns.\n";
   cout << "Runtime durations:\n";
-  for (auto& t : mDurationActions) {
+  for (auto& t : mDurationActions.toVector()) {
     auto d = std::get<0>(t);
     auto action = std::get<1>(t);
     if (action == ActionType::initDiscovery) {
-      cout << " initDiscovery: " << d << " ms.\n";
+      Inspector::printDuration("initDiscovery", d);
     }
   }
+  if (mStatus == RunStatus::EarlyExit) {
+    cout << "Runtime status: early exit at " << std::get<0>(mExitRange) << "+"
+         << std::get<1>(mExitRange) << "\n";
+  } else if (mStatus != RunStatus::Completed) {
+    cout << "Runtime status: " << statusName(mStatus) << "\n";
+  }
   for (auto& device : mDevices) {
     device.printStats();
   }
   mScheduler->printStats();
+  auto runStats = stats();
+  auto& balance = runStats.balance;
+  cout << "Balance:\n";
+  Inspector::printDuration("makespan", balance.makespan_ns);
+  cout << " efficiency: " << balance.efficiency << "\n";
+  cout << " speedup: " << balance.speedup
+       << (balance.baselineMeasured ? " (measured baseline)\n" : "\n");
+  auto& handoff = runStats.scheduler.handoff;
+  if (!handoff.empty() && handoff.back().samples > 0) {
+    cout << "Hand-off (" << handoff.back().samples << " chunks, p50/p99/max ms):\n";
+    for (auto& latency : handoff) {
+      cout << " " << latency.name << ": " << Inspector::toMs(latency.p50_ns) << "/"
+           << Inspector::toMs(latency.p99_ns) << "/" << Inspector::toMs(latency.max_ns) << "\n";
+    }
+  }
+}
+
+/**
+ * \brief Statistics of the run (same data as `printStats`), serializable to JSON and CSV.
+ */
+Stats
+Runtime::stats()
+{
+  Stats stats;
+  stats.kernel = mKernel;
+  stats.status = statusName(getStatus());
+  stats.phases = phasesFromOffsets(mDurationOffsetActions.toVector());
+  stats.devices.reserve(mDevices.size());
+  for (auto& device : mDevices) {
+    stats.devices.push_back(device.getStats());
+  }
+  stats.scheduler = mScheduler->getStats();
+#if ECL_HANDOFF_PROFILING
+  stats.scheduler.handoff = handOffLatencies(mDevices);
+#endif
+  stats.completed = mScheduler->getCompletedRanges();
+  computeBalance(stats, mBaselineNs);
+  return stats;
+}
+
+/**
+ * \brief Time of the problem in the fastest device alone, for the speedup of the stats. Without
+ * baseline, it is measured from the throughput of the devices in the run.
+ */
+void
+Runtime::setBaseline(std::chrono::nanoseconds time)
+{
+  mBaselineNs = time.count();
+}
+
+//! \brief Baseline predicted by the profiles of the calibration (fastest device alone).
+void
+Runtime::setBaseline(const Calibration& calibration)
+{
+  double best = 0.0;
+  for (auto& profile : calibration.profiles) {
+    auto alone = profile.fixedSeconds() + mGws[0] * profile.secondsPerItem();
+    if (best == 0.0 || alone < best) {
+      best = alone;
+    }
+  }
+  mBaselineNs = static_cast<size_t>(best * 1e9);
+}
+
+/**
+ * \brief Saves the work given to every device (`DecisionLog`), to be replayed by a
+ * `ReplayScheduler` in another run of the same problem size. The dynamic scheduler keeps the
+ * latest ECL_EVENTS_CAPACITY dispatches, so it throws for longer runs (see `recordDecisions`).
+ * The work lost with a failed device is only saved as dispatched to the survivor.
+ */
+void
+Runtime::saveDecisions(const string& path)
+{
+  auto dropped = mScheduler->getDispatchesDropped();
+  if (dropped > 0) {
+    throw runtime_error("the oldest " + to_string(dropped) +
+                        " dispatches were dropped (see ECL_EVENTS_CAPACITY), not replayable;"
+                        " record them while running with recordDecisions");
+  }
+  DecisionLog log;
+  log.size = mGws[0];
+  log.dispatches = mScheduler->getDispatches();
+  auto& dispatches = log.dispatches;
+  for (auto& recovery : mScheduler->getStats().recoveries) {
+    auto lost = find_if(begin(dispatches), end(dispatches), [&recovery](const Dispatch& d) {
+      return d.device == recovery.from && d.offset == recovery.offset && d.size == recovery.size;
+    });
+    if (lost != end(dispatches)) {
+      dispatches.erase(lost);
+    }
+  }
+  log.save(path);
+}
+
+/**
+ * \brief Writes the decisions of the next run to `path` as they are taken (as `saveDecisions`),
+ * so the log is complete and the memory does not grow with the number of chunks.
+ */
+void
+Runtime::recordDecisions(const string& path)
+{
+  mDecisionWriter = make_unique<DecisionWriter>(path, mGws[0]);
+}
+
+/**
+ * \brief Exports the counters of the runs to `exporter` while running. The exporter is owned by
+ * the caller and may be shared by many runtimes.
+ */
+void
+Runtime::setMetricsExporter(MetricsExporter* exporter)
+{
+  mMetrics = exporter;
+}
+
+//! \brief Counters of the devices and queue depth, read without locks (while running too).
+MetricsSnapshot
+Runtime::metrics()
+{
+  MetricsSnapshot snapshot;
+  snapshot.devices.reserve(mDevices.size());
+  for (auto& device : mDevices) {
+    auto& m = device.getMetrics();
+    snapshot.devices.push_back({ device.getID(),
+                                 m.chunks.load(std::memory_order_relaxed),
+                                 m.items.load(std::memory_order_relaxed),
+                                 m.writeBytes.load(std::memory_order_relaxed),
+                                 m.readBytes.load(std::memory_order_relaxed),
+                                 m.waitNs.load(std::memory_order_relaxed) });
+  }
+  snapshot.queueDepth = mScheduler ? mScheduler->getQueueDepth() : 0;
+  return snapshot;
+}
+
+/**
+ * \brief Saves the timeline of the run as a Chrome Trace Event JSON file.
+ *
+ * There is a track for the runtime, the scheduler (phases and work dispatched) and each device
+ * (phases, chunks and, with `setProfiling`, the kernels and transfers).
+ */
+void
+Runtime::saveTrace(const string& path)
+{
+  Trace trace;
+  trace.setTrackName(0, "runtime");
+  addPhases(trace, 0, phasesFromOffsets(mDurationOffsetActions.toVector()));
+
+  trace.setTrackName(1, "scheduler");
+  addPhases(trace, 1, phasesFromOffsets(mScheduler->getDurationOffsets()));
+  for (auto& dispatch : mScheduler->getDispatches()) {
+    trace.addInstant(1,
+                     "dispatch",
+                     "scheduler",
+                     dispatch.ts_ns,
+                     "\"device\":" + to_string(dispatch.device) + "," +
+                       rangeArgs(dispatch.offset, dispatch.size));
+  }
+
+  for (auto& device : mDevices) {
+    int track = device.getID() + 2;
+    trace.setTrackName(track,
+                       "device " + to_string(device.getID()) + " (" +
+                         to_string(device.getPlatformIndex()) + "." +
+                         to_string(device.getDeviceIndex()) + ")");
+    addPhases(trace, track, phasesFromOffsets(device.getDurationOffsets()));
+#if ECL_SAVE_CHUNKS
+    for (auto& chunk : device.getChunks()) {
+      trace.addSpan(
+        track, "chunk", "chunk", chunk.ts_ns, chunk.duration_ns, rangeArgs(chunk.offset, chunk.size));
+    }
+#endif
+    for (auto& command : device.getCommandProfiles()) {
+      string name = "write";
+      if (command.type == CommandType::Kernel) {
+        name = "kernel";
+      } else if (command.type == CommandType::Read) {
+        name = "read";
+      }
+      // device clock aligned with the host when the command was queued
+      size_t ts = command.enqueued + (command.start - command.queued);
+      trace.addSpan(track, name, "command", ts, command.end - command.start);
+    }
+  }
+  trace.save(path);
 }
 
 void
 Runtime::setKernel(const string& source, const string& kernel)
 {
+  if (mPrepared) {
+    throw runtime_error("setKernel should be called before prepare");
+  }
   for (auto& device : mDevices) {
     device.setKernel(source, kernel);
   }
   mKernel = kernel;
 }
 
+/**
+ * \brief Kernel of the `HostDevice`s: computes the work-items [offset, offset + size).
+ *
+ * It should only update the registered arrays, as `calibrate` restores them after probing.
+ */
+void
+Runtime::setHostKernel(ThreadPool::Task kernel)
+{
+  if (mPrepared) {
+    throw runtime_error("setHostKernel should be called before prepare");
+  }
+  for (auto& device : mDevices) {
+    device.setHostKernel(kernel);
+  }
+  mHasHostKernel = true;
+}
+
 void
 Runtime::setKernelArgLocalAlloc(cl_uint index, const uint bytes)
 {
@@ -91,6 +400,86 @@ Runtime::setKernelArgLocalAlloc(cl_uint index, const uint bytes)
   }
 }
 
+/**
+ * \brief Enables the OpenCL event profiling of the transfers and kernels in every device.
+ */
+void
+Runtime::setProfiling(bool profiling)
+{
+  if (mPrepared) {
+    throw runtime_error("setProfiling should be called before prepare");
+  }
+  for (auto& device : mDevices) {
+    device.setProfiling(profiling);
+  }
+}
+
+/**
+ * \brief Pins the host threads of the devices and the scheduler (`AffinityPolicy`). The device
+ * ids of the policy are the indices of the devices given to the runtime.
+ */
+void
+Runtime::setAffinity(const AffinityPolicy& policy)
+{
+  if (mPrepared) {
+    throw runtime_error("setAffinity should be called before prepare");
+  }
+  auto available = availableCpus();
+  for (auto cpu : policy.reservedCpus()) {
+    if (!std::binary_search(available.begin(), available.end(), cpu)) {
+      throw runtime_error("CPU " + to_string(cpu) + " is not available to the process (" +
+                          formatCpuList(available) + ")");
+    }
+  }
+  mAffinity = policy;
+}
+
+//! \brief NUMA node of the CPUs of the device thread (`setAffinity`), -1 if it is not in one node.
+int
+Runtime::getDeviceNode(uint id)
+{
+  auto cpus = mAffinity.getDevice(id);
+  return cpus.empty() ? -1 : cpusNode(cpus);
+}
+
+/**
+ * \brief Every device writes its inputs from a copy first touched by its thread, so the pages
+ * read by the transfers are in the node where the thread runs (pin it with `setAffinity`).
+ * It costs a copy of the inputs per device.
+ */
+void
+Runtime::setNodeLocalStaging(bool staging)
+{
+  if (mPrepared) {
+    throw runtime_error("setNodeLocalStaging should be called before prepare");
+  }
+  for (auto& device : mDevices) {
+    device.setNodeLocalStaging(staging);
+  }
+}
+
+/**
+ * \brief Drives every device from a single `Reactor` thread instead of a thread per device. The
+ * reactor runs on the CPUs of every device of the `AffinityPolicy`. The read backs are not
+ * blocking (whatever ECL_OPERATION_BLOCKING_READ) so the devices overlap.
+ */
+void
+Runtime::setReactor(bool reactor)
+{
+  if (mPrepared) {
+    throw runtime_error("setReactor should be called before prepare");
+  }
+  mReactorMode = reactor;
+}
+
+void
+Runtime::setKernelArgExitFlag(cl_uint index)
+{
+  for (auto& device : mDevices) {
+    device.setKernelArgExitFlag(index);
+  }
+}
+
 void
 Runtime::discoverDevices()
 {
@@ -109,8 +498,7 @@ Runtime::discoverDevices()
 cl::Platform
 Runtime::usePlatformDiscovery(uint selPlatform)
 {
-  auto last_platform = mPlatforms.size() - 1;
-  if (selPlatform > last_platform) {
+  if (selPlatform >= mPlatforms.size()) {
     throw runtime_error("invalid platform selected");
   }
   return mPlatforms[selPlatform];
@@ -119,29 +507,157 @@ Runtime::usePlatformDiscovery(uint selPlatform)
 cl::Device
 Runtime::useDeviceDiscovery(uint selPlatform, uint selDevice)
 {
-  auto last_platform = mPlatforms.size() - 1;
-  if (selPlatform > last_platform) {
+  if (selPlatform >= mPlatforms.size()) {
     throw runtime_error("invalid platform selected");
   }
-  auto last_device = mPlatformDevices[selPlatform].size() - 1;
-  if (selDevice > last_device) {
+  if (selDevice >= mPlatformDevices[selPlatform].size()) {
     throw runtime_error("invalid device selected");
   }
   return mPlatformDevices[selPlatform][selDevice];
 }
 
+/**
+ * \brief Starts the device threads, warming up the devices (context, queue and program build).
+ *
+ * The scheduler and the kernel should be set before. The buffers can be filled and the kernel
+ * args set until `run`, so the host data preparation overlaps with the device initialization.
+ * Calling it is optional, `run` prepares the devices if they are not prepared yet.
+ */
 void
-Runtime::run()
+Runtime::prepare()
 {
-  mScheduler->start();
+  if (mPrepared) {
+    return;
+  }
+  if (mScheduler == nullptr) {
+    throw runtime_error("setScheduler should be called before prepare");
+  }
+  auto hosts = std::count_if(
+    mDevices.begin(), mDevices.end(), [](Device& device) { return device.isHost(); });
+  auto opencl = std::count_if(mDevices.begin(), mDevices.end(), [](Device& device) {
+    return !device.isHost() && !device.isSimulated();
+  });
+  if (mKernel.empty() && opencl > 0) {
+    throw runtime_error("setKernel should be called before prepare");
+  }
+  if (!mHasHostKernel && hosts > 0) {
+    throw runtime_error("setHostKernel should be called before prepare (host devices)");
+  }
 
   discoverDevices();
   saveDuration(ActionType::initDiscovery);
   saveDurationOffset(ActionType::initDiscovery);
 
-  for (auto& device : mDevices) {
+  auto reserved = mAffinity.getExcludeFromCpuDevices() ? mAffinity.reservedCpus().size() : 0;
+  vector<int> reactorCpus;
+  for (size_t i = 0; i < mDevices.size(); ++i) {
+    auto cpus = mAffinity.getDevice(i);
+    reactorCpus.insert(reactorCpus.end(), cpus.begin(), cpus.end());
+  }
+  vector<Device*> devices;
+  for (size_t i = 0; i < mDevices.size(); ++i) {
+    auto& device = mDevices[i];
+    device.setAffinity(mReactorMode ? reactorCpus : mAffinity.getDevice(i));
+    device.setReservedCpus(reserved);
     device.setBarrier(mBarrier);
-    device.start();
+    devices.push_back(&device);
+  }
+
+  if (mReactorMode) {
+    mReactor = make_unique<Reactor>(move(devices));
+    for (auto& device : mDevices) {
+      device.setReactor(mReactor.get());
+    }
+    mReactor->start();
+  } else {
+    for (auto& device : mDevices) {
+      device.start();
+    }
+  }
+  mPrepared = true;
+}
+
+//! \brief Clears the running flag when `run` returns or throws.
+class RunningScope
+{
+public:
+  RunningScope(mutex& mutexRun, bool& running)
+    : mMutexRun(mutexRun)
+    , mRunning(running)
+  {}
+  ~RunningScope()
+  {
+    lock_guard<mutex> lock(mMutexRun);
+    mRunning = false;
+  }
+
+private:
+  mutex& mMutexRun;
+  bool& mRunning;
+};
+
+//! \brief Attaches the runtime to the exporter while running, detaching it when `run` returns or
+//! throws.
+class MetricsScope
+{
+public:
+  MetricsScope(MetricsExporter* metrics, Runtime* runtime)
+    : mMetrics(metrics)
+    , mRuntime(runtime)
+  {
+    if (mMetrics) {
+      mMetrics->attach(mRuntime);
+    }
+  }
+  ~MetricsScope()
+  {
+    if (mMetrics) {
+      mMetrics->detach(mRuntime);
+    }
+  }
+
+private:
+  MetricsExporter* mMetrics;
+  Runtime* mRuntime;
+};
+
+/**
+ * \brief Co-executes the kernel, returning when every device is done.
+ *
+ * If the run is cancelled or reaches its deadline, the scheduler stops giving work: the packages
+ * not started are dropped and the chunks in flight are completed (a launched kernel cannot be
+ * aborted), so the status tells the ranges completed (`getCompletedRanges`). The same happens
+ * when a chunk raises the exit flag (`setKernelArgExitFlag`, see `getExitRange`). Throws if every
+ * device failed.
+ */
+RunStatus
+Runtime::run()
+{
+  if (mCalibrating) {
+    throw runtime_error("the runtime was used to calibrate, it cannot run");
+  }
+  prepare();
+
+  mScheduler->setAffinity(mAffinity.getScheduler());
+  mScheduler->setDecisionWriter(mDecisionWriter.get());
+  mScheduler->start();
+  RunningScope running(mMutexRun, mRunning);
+  {
+    lock_guard<mutex> lock(mMutexRun);
+    mRunning = true;
+    if (mStatus != RunStatus::Completed) { // cancelled before running
+      mScheduler->cancel();
+    }
+  }
+  MetricsScope metrics(mMetrics, this);
+
+  mHasExitRange = false;
+  for (auto& device : mDevices) {
+    device.resetExit();
+  }
+  mStarted = true;
+  for (auto& device : mDevices) {
+    device.notifyData();
   }
 
   if (ECL_RUNTIME_WAIT_ALL_READY) {
@@ -152,7 +668,184 @@ Runtime::run()
     device.notifyRun();
   }
 
+  if (mHasDeadline) {
+    if (!mBarrier.get()->wait_until(mDeadline, mDevices.size())) {
+      stop(RunStatus::DeadlineExceeded);
+      mBarrier.get()->wait(mDevices.size());
+    }
+  } else {
+    mBarrier.get()->wait(mDevices.size());
+  }
+  mScheduler->setDecisionWriter(nullptr);
+  if (mDecisionWriter) {
+    auto writer = move(mDecisionWriter);
+    writer->close();
+  }
+
+  string failures;
+  auto survivors = 0;
+  for (auto& device : mDevices) {
+    if (device.isQuarantined()) {
+      failures += " [device " + to_string(device.getID()) + "] " + device.getFailure();
+    } else {
+      survivors++;
+    }
+  }
+  if (survivors == 0) {
+    throw runtime_error("every device failed:" + failures);
+  }
+
+  lock_guard<mutex> lock(mMutexRun);
+  if (mStatus == RunStatus::Cancelled || mStatus == RunStatus::DeadlineExceeded) {
+    auto ranges = mScheduler->getCompletedRanges();
+    if (ranges.size() == 1 && std::get<1>(ranges[0]) == mGws[0]) {
+      mStatus = RunStatus::Completed; // stopped once everything was computed
+    }
+  }
+  return mStatus;
+}
+
+void
+Runtime::stop(RunStatus status)
+{
+  lock_guard<mutex> lock(mMutexRun);
+  if (mStatus != RunStatus::Completed) {
+    return; // the first reason wins
+  }
+  mStatus = status;
+  if (mRunning) {
+    mScheduler->cancel();
+  }
+}
+
+/**
+ * \brief Stops the run as soon as possible. Thread-safe, it can be called before `run`.
+ */
+void
+Runtime::cancel()
+{
+  stop(RunStatus::Cancelled);
+}
+
+/**
+ * \brief Stops the run when it reaches `deadline`, as `cancel` does.
+ */
+void
+Runtime::setDeadline(std::chrono::steady_clock::time_point deadline)
+{
+  mDeadline = deadline;
+  mHasDeadline = true;
+}
+
+/**
+ * \brief A chunk raised the exit flag: the run stops keeping the chunk with the lowest offset.
+ */
+void
+Runtime::exitFound(int queueIndex)
+{
+  Work work = mScheduler->getWork(queueIndex);
+  {
+    lock_guard<mutex> lock(mMutexRun);
+    if (!mHasExitRange || work.mOffset < std::get<0>(mExitRange)) {
+      mExitRange = make_tuple(work.mOffset, work.mSize);
+      mHasExitRange = true;
+    }
+  }
+  stop(RunStatus::EarlyExit);
+}
+
+//! \brief The (offset, size) chunk that raised the exit flag (the lowest, if many did).
+tuple<size_t, size_t>
+Runtime::getExitRange()
+{
+  lock_guard<mutex> lock(mMutexRun);
+  if (!mHasExitRange) {
+    throw runtime_error("no chunk raised the exit flag");
+  }
+  return mExitRange;
+}
+
+RunStatus
+Runtime::getStatus()
+{
+  lock_guard<mutex> lock(mMutexRun);
+  return mStatus;
+}
+
+//! \brief Completed (offset, size) ranges of the last run, in work-items of the gws.
+vector<tuple<size_t, size_t>>
+Runtime::getCompletedRanges()
+{
+  return mScheduler->getCompletedRanges();
+}
+
+/**
+ * \brief Runs a short probe of the kernel in every device instead of a co-execution.
+ *
+ * Each device measures the transfer of the inputs, the launch latency, the kernel throughput and
+ * the read back of `probeSize` work-items (by default 1% of the problem). The plan selects the
+ * devices and proportions minimizing the makespan of the problem size (gws), leaving out the
+ * devices that would finish after the rest. The runtime is consumed: a new runtime with the
+ * selected devices should run the problem (eg. `StaticScheduler::setRawProportions`). The arrays
+ * registered with `setInBuffer`/`setOutBuffer` are restored after the probes.
+ */
+Calibration
+Runtime::calibrate(size_t probeSize)
+{
+  if (mCalibrating) {
+    throw runtime_error("the runtime was already calibrated");
+  }
+  size_t size = mGws[0];
+  if (probeSize == 0) {
+    probeSize = size / 100;
+  }
+  probeSize = std::min(probeSize, size);
+  probeSize = std::max((probeSize / mLws) * mLws, mLws);
+  mProbeSize = probeSize;
+  mCalibrating = true;
+
+  prepare();
+
+  // the probes run the kernels over the registered arrays, and a kernel updating them (in place
+  // or accumulating) would leave them changed for the run of the plan
+  vector<unique_ptr<char[]>> backups;
+  for (auto& array : mArrays) {
+    backups.emplace_back(new char[std::get<1>(array)]);
+    std::memcpy(backups.back().get(), std::get<0>(array), std::get<1>(array));
+  }
+
+  mStarted = true;
+  for (auto& device : mDevices) {
+    device.notifyData();
+  }
+  for (auto& device : mDevices) {
+    device.notifyRun();
+  }
   mBarrier.get()->wait(mDevices.size());
+
+  for (size_t i = 0; i < mArrays.size(); ++i) {
+    std::memcpy(std::get<0>(mArrays[i]), backups[i].get(), std::get<1>(mArrays[i]));
+  }
+
+  vector<DeviceProfile> profiles;
+  for (auto& device : mDevices) {
+    if (!device.isQuarantined()) {
+      profiles.push_back(device.getProfile());
+    }
+  }
+  return planDevices(profiles, size);
+}
+
+bool
+Runtime::isCalibrating()
+{
+  return mCalibrating;
+}
+
+void
+Runtime::probe(Device& device)
+{
+  device.probe(mProbeSize, mOutWorkitems, mOutPositions);
 }
 
 void
@@ -183,6 +876,7 @@ void
 Runtime::setScheduler(Scheduler* scheduler)
 {
   mScheduler = scheduler;
+  mScheduler->setTimeInit(mTimeInit);
   mScheduler->setTotalSize(mGws[0]); // TODO gws[0] ?
   mScheduler->setGws(mGws);
   mScheduler->setLws(mLws);
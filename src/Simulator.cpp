@@ -0,0 +1,363 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#include "Simulator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+
+namespace ecl {
+
+static size_t
+toNs(double seconds)
+{
+  return static_cast<size_t>(std::round(std::max(seconds, 0.0) * 1e9));
+}
+
+static double
+transferSeconds(double bytes, double bandwidth)
+{
+  return bandwidth > 0.0 ? bytes / bandwidth : 0.0;
+}
+
+double
+DeviceModel::fixedSeconds() const
+{
+  return transferSeconds(writeBytes, writeBandwidth) + launchSeconds;
+}
+
+double
+DeviceModel::secondsPerItem() const
+{
+  return 1.0 / itemsPerSecond + transferSeconds(readBytesPerItem, readBandwidth);
+}
+
+double
+DeviceModel::writeSeconds() const
+{
+  return transferSeconds(writeBytes, writeBandwidth);
+}
+
+double
+DeviceModel::readSeconds(size_t items) const
+{
+  return transferSeconds(items * readBytesPerItem, readBandwidth);
+}
+
+DeviceModel
+DeviceModel::fromProfile(const DeviceProfile& profile)
+{
+  if (profile.probeSize == 0) {
+    throw std::runtime_error("device profile without probe size");
+  }
+  DeviceModel model;
+  model.name = to_string(profile.platform) + ":" + to_string(profile.device);
+  model.itemsPerSecond = profile.itemsPerSecond();
+  model.launchSeconds = profile.launchSeconds;
+  model.writeBytes = profile.writeBytes;
+  model.writeBandwidth = profile.writeBandwidth();
+  model.readBytesPerItem = static_cast<double>(profile.readBytes) / profile.probeSize;
+  model.readBandwidth = profile.readBandwidth();
+  model.noise = 0.0;
+  return model;
+}
+
+/**
+ * Without profiling, the chunk time includes the transfers, so they are not modelled apart. With
+ * profiling, the kernel time is fitted and the rest of the chunk (host overhead) is the launch.
+ */
+DeviceModel
+DeviceModel::fit(const DeviceStats& stats)
+{
+  auto& chunks = stats.chunks;
+  if (chunks.empty()) {
+    throw std::runtime_error("cannot fit the model of device " + to_string(stats.id) +
+                             " without chunks");
+  }
+  auto profiled = stats.kernel_ns > 0;
+  auto timeOf = [&](const ChunkStats& c) {
+    return static_cast<double>(profiled ? c.kernel_ns : c.duration_ns);
+  };
+
+  double n = chunks.size();
+  double meanX = 0.0;
+  double meanY = 0.0;
+  for (auto& c : chunks) {
+    meanX += c.size / n;
+    meanY += timeOf(c) / n;
+  }
+  double sxx = 0.0;
+  double sxy = 0.0;
+  for (auto& c : chunks) {
+    sxx += (c.size - meanX) * (c.size - meanX);
+    sxy += (c.size - meanX) * (timeOf(c) - meanY);
+  }
+  // ns per item and per chunk; a single chunk size (or a negative slope) has no intercept
+  double slope = sxx > 0.0 ? sxy / sxx : 0.0;
+  double intercept = meanY - slope * meanX;
+  if (slope <= 0.0 || intercept < 0.0) {
+    slope = meanY / std::max(meanX, 1.0);
+    intercept = 0.0;
+  }
+  slope = std::max(slope, 1e-9);
+
+  double noise = 0.0;
+  double overhead = 0.0;
+  for (auto& c : chunks) {
+    auto predicted = intercept + slope * c.size;
+    auto relative = predicted > 0.0 ? (timeOf(c) - predicted) / predicted : 0.0;
+    noise += relative * relative / n;
+    if (profiled && c.duration_ns > c.kernel_ns + c.transfer_ns) {
+      overhead += (c.duration_ns - c.kernel_ns - c.transfer_ns) / n;
+    }
+  }
+
+  DeviceModel model;
+  model.name = to_string(stats.platform) + ":" + to_string(stats.device);
+  model.itemsPerSecond = 1e9 / slope;
+  model.launchSeconds = (intercept + overhead) / 1e9;
+  model.writeBytes = 0;
+  model.writeBandwidth = 0.0;
+  model.readBytesPerItem = 0.0;
+  model.readBandwidth = 0.0;
+  model.noise = std::sqrt(noise);
+  if (profiled) {
+    model.writeBytes = stats.writeBytes;
+    model.writeBandwidth = stats.write_gbps * 1e9;
+    model.readBytesPerItem =
+      stats.worksSize > 0 ? static_cast<double>(stats.readBytes) / stats.worksSize : 0.0;
+    model.readBandwidth = stats.read_gbps * 1e9;
+  }
+  return model;
+}
+
+Simulator::Simulator(vector<DeviceModel> models,
+                     size_t gws,
+                     size_t lws,
+                     uint outWorkitems,
+                     uint outPositions)
+  : mModels(move(models))
+  , mGws(gws)
+  , mLws(lws)
+  , mOutWorkitems(outWorkitems)
+  , mOutPositions(outPositions)
+  , mScheduler(nullptr)
+  , mSeed(0)
+  , mTimeout(1000)
+{
+  if (mModels.empty()) {
+    throw std::runtime_error("the simulator requires at least one device model");
+  }
+  mDevices.reserve(mModels.size());
+  for (size_t i = 0; i < mModels.size(); ++i) {
+    if (mModels[i].itemsPerSecond <= 0.0) {
+      throw std::runtime_error("the model of " + mModels[i].name + " requires a throughput");
+    }
+    mDevices.emplace_back(Device(99, i));
+  }
+}
+
+/**
+ * \brief Configures the scheduler as `Runtime::setScheduler`. The devices are reused between runs
+ * (their event rings are large), dropping the wake ups left by the previous scheduler.
+ */
+void
+Simulator::setScheduler(Scheduler* scheduler)
+{
+  mScheduler = scheduler;
+  vector<Device*> devices;
+  for (auto& device : mDevices) {
+    while (device.waitWork(std::chrono::nanoseconds(0))) {
+    }
+  }
+  mScheduler->setTimeInit(std::chrono::steady_clock::now());
+  mScheduler->setTotalSize(mGws);
+  mScheduler->setGws(NDRange(mGws));
+  mScheduler->setLws(mLws);
+  mScheduler->setOutPattern(mOutWorkitems, mOutPositions);
+  for (size_t i = 0; i < mDevices.size(); ++i) {
+    mDevices[i].setID(i);
+    mDevices[i].setScheduler(mScheduler);
+    mDevices[i].setLWS(mLws);
+    devices.push_back(&mDevices[i]);
+  }
+  mScheduler->setDevices(move(devices));
+}
+
+void
+Simulator::setSeed(unsigned int seed)
+{
+  mSeed = seed;
+}
+
+void
+Simulator::setTimeout(std::chrono::milliseconds timeout)
+{
+  mTimeout = timeout;
+}
+
+size_t
+Simulator::baselineNs()
+{
+  double best = 0.0;
+  for (auto& model : mModels) {
+    auto alone = model.fixedSeconds() + mGws * model.secondsPerItem();
+    if (best == 0.0 || alone < best) {
+      best = alone;
+    }
+  }
+  return toNs(best);
+}
+
+//! \brief Waits (in real time) until the scheduler thread has given work for every request.
+void
+Simulator::waitServed()
+{
+  auto t1 = std::chrono::steady_clock::now();
+  while (mScheduler->getUnservedRequests() > 0) {
+    if (std::chrono::steady_clock::now() - t1 > mTimeout) {
+      mScheduler->cancel(); // releases its thread
+      throw std::runtime_error("simulation: the scheduler does not serve its requests");
+    }
+    std::this_thread::yield();
+  }
+}
+
+/**
+ * \brief Simulates the run. The events are the requests of the devices (once their input is
+ * written) and the completion of their chunks; between events, the devices woken by the scheduler
+ * take their next chunk (or leave). Throws if the scheduler stops progressing (`setTimeout`).
+ */
+Stats
+Simulator::run()
+{
+  if (mScheduler == nullptr) {
+    throw std::runtime_error("setScheduler should be called before run");
+  }
+  enum class State
+  {
+    Writing,
+    Waiting,
+    Busy,
+    Done,
+  };
+  auto len = mDevices.size();
+  vector<State> state(len, State::Writing);
+  vector<vector<ChunkStats>> chunks(len);
+  vector<Dispatch> dispatches;
+  std::mt19937 rng(mSeed);
+  std::normal_distribution<double> normal(0.0, 1.0);
+
+  // (virtual ns, device, queue index or -1 for its first request)
+  using Event = tuple<size_t, int, int>;
+  std::priority_queue<Event, vector<Event>, std::greater<Event>> events;
+  for (size_t id = 0; id < len; ++id) {
+    auto& model = mModels[id];
+    auto written = toNs(transferSeconds(model.writeBytes, model.writeBandwidth));
+    events.push(std::make_tuple(written, id, -1));
+  }
+
+  size_t now = 0;
+  size_t done = 0;
+  mScheduler->start();
+  auto progress = std::chrono::steady_clock::now();
+  while (done < len) {
+    waitServed();
+    auto woken = false;
+    for (size_t id = 0; id < len; ++id) {
+      if (state[id] != State::Waiting || !mDevices[id].waitWork(std::chrono::nanoseconds(0))) {
+        continue;
+      }
+      woken = true;
+      auto index = mScheduler->getWorkIndex(&mDevices[id]);
+      if (index < 0) {
+        state[id] = State::Done;
+        done++;
+        continue;
+      }
+      auto work = mScheduler->getWork(index);
+      auto& model = mModels[id];
+      auto factor = model.noise > 0.0 ? std::max(0.0, 1.0 + model.noise * normal(rng)) : 1.0;
+      auto kernel = toNs(work.mSize / model.itemsPerSecond * factor);
+      auto transfer =
+        toNs(transferSeconds(work.mSize * model.readBytesPerItem, model.readBandwidth));
+      auto duration = toNs(model.launchSeconds) + kernel + transfer;
+      chunks[id].push_back({ work.mOffset, work.mSize, now, duration, kernel, transfer });
+      dispatches.push_back({ now, static_cast<int>(id), work.mOffset, work.mSize });
+      events.push(std::make_tuple(now + duration, id, index));
+      state[id] = State::Busy;
+    }
+    if (woken) {
+      progress = std::chrono::steady_clock::now();
+      continue;
+    }
+    if (events.empty()) {
+      if (std::chrono::steady_clock::now() - progress > mTimeout) {
+        mScheduler->cancel();
+        throw std::runtime_error("simulation: the scheduler deadlocked at " + to_string(now) +
+                                 " ns");
+      }
+      std::this_thread::yield();
+      continue;
+    }
+    size_t ts;
+    int id, index;
+    std::tie(ts, id, index) = events.top();
+    events.pop();
+    now = ts;
+    state[id] = State::Waiting;
+    if (index < 0) {
+      mScheduler->requestWork(&mDevices[id]);
+    } else {
+      mScheduler->callback(index);
+    }
+    progress = std::chrono::steady_clock::now();
+  }
+
+  Stats stats;
+  stats.kernel = "simulated";
+  stats.status = "completed";
+  for (size_t id = 0; id < len; ++id) {
+    auto& model = mModels[id];
+    DeviceStats device{};
+    device.id = id;
+    device.device = id;
+    device.quarantined = false;
+    device.writeBytes = model.writeBytes;
+    device.writes = model.writeBytes > 0 ? 1 : 0;
+    device.write_ns = toNs(transferSeconds(model.writeBytes, model.writeBandwidth));
+    for (auto& c : chunks[id]) {
+      device.works++;
+      device.worksSize += c.size;
+      device.kernel_ns += c.kernel_ns;
+      device.read_ns += c.transfer_ns;
+      device.overhead_ns += c.duration_ns - c.kernel_ns - c.transfer_ns;
+      device.reads++;
+      device.readBytes += static_cast<size_t>(c.size * model.readBytesPerItem);
+    }
+    if (device.write_ns > 0) {
+      device.write_gbps = static_cast<double>(device.writeBytes) / device.write_ns;
+    }
+    if (device.read_ns > 0) {
+      device.read_gbps = static_cast<double>(device.readBytes) / device.read_ns;
+    }
+    device.chunks = move(chunks[id]);
+    stats.devices.push_back(move(device));
+  }
+  stats.scheduler = mScheduler->getStats();
+  stats.scheduler.phases.clear(); // in real time
+  stats.scheduler.dispatches = move(dispatches);
+  stats.completed = mScheduler->getCompletedRanges();
+  computeBalance(stats, baselineNs());
+  return stats;
+}
+
+} // namespace ecl
@@ -0,0 +1,242 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#include "Stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+#include "Affinity.hpp"
+#include "Inspector.hpp"
+#include "Json.hpp"
+
+using std::ostringstream;
+using std::to_string;
+
+namespace ecl {
+
+vector<PhaseStats>
+phasesFromOffsets(const vector<tuple<size_t, ActionType>>& offsets)
+{
+  vector<PhaseStats> phases;
+  phases.reserve(offsets.size());
+  size_t previous = 0;
+  for (auto& t : offsets) {
+    auto ns = std::get<0>(t);
+    auto duration = phases.empty() ? 0 : ns - previous;
+    phases.push_back({ Inspector::actionTypeName(std::get<1>(t)), ns, duration });
+    previous = ns;
+  }
+  return phases;
+}
+
+void
+computeBalance(Stats& stats, size_t baselineNs)
+{
+  size_t start = 0;
+  size_t end = 0;
+  size_t items = 0;
+  auto first = true;
+  for (auto& d : stats.devices) {
+    for (auto& c : d.chunks) {
+      if (first || c.ts_ns < start) {
+        start = c.ts_ns;
+      }
+      end = std::max(end, c.ts_ns + c.duration_ns);
+      items += c.size;
+      first = false;
+    }
+  }
+
+  auto& balance = stats.balance;
+  balance.makespan_ns = end - start;
+  balance.baseline_ns = baselineNs;
+  balance.baselineMeasured = baselineNs == 0;
+  size_t firstFinish = 0;
+  size_t lastFinish = 0;
+  auto working = 0;
+  for (auto& d : stats.devices) {
+    d.busy_ns = d.idle_ns = d.finish_ns = d.lag_ns = 0;
+    size_t deviceItems = 0;
+    for (size_t i = 0; i < d.chunks.size(); ++i) {
+      auto& c = d.chunks[i];
+      d.busy_ns += c.duration_ns;
+      if (i > 0) {
+        auto previousEnd = d.chunks[i - 1].ts_ns + d.chunks[i - 1].duration_ns;
+        d.idle_ns += c.ts_ns > previousEnd ? c.ts_ns - previousEnd : 0;
+      }
+      d.finish_ns = std::max(d.finish_ns, c.ts_ns + c.duration_ns - start);
+      deviceItems += c.size;
+    }
+    if (deviceItems == 0) {
+      continue; // no work, out of the balance
+    }
+    firstFinish = working == 0 ? d.finish_ns : std::min(firstFinish, d.finish_ns);
+    lastFinish = std::max(lastFinish, d.finish_ns);
+    working++;
+    if (balance.baselineMeasured) {
+      auto alone = static_cast<size_t>(static_cast<double>(d.busy_ns) * items / deviceItems);
+      balance.baseline_ns = balance.baseline_ns == 0 ? alone : std::min(balance.baseline_ns, alone);
+    }
+  }
+  for (auto& d : stats.devices) {
+    if (!d.chunks.empty()) {
+      d.lag_ns = lastFinish - d.finish_ns;
+    }
+  }
+  balance.efficiency = lastFinish > 0 ? static_cast<double>(firstFinish) / lastFinish : 0.0;
+  balance.speedup =
+    balance.makespan_ns > 0 ? static_cast<double>(balance.baseline_ns) / balance.makespan_ns : 0.0;
+}
+
+LatencyStats
+latencyStats(const string& name, vector<size_t> samples)
+{
+  LatencyStats stats{ name, samples.size(), 0, 0, 0 };
+  if (samples.empty()) {
+    return stats;
+  }
+  std::sort(begin(samples), end(samples));
+  auto rank = [&](double p) {
+    auto n = static_cast<size_t>(std::ceil(p * samples.size()));
+    return samples[std::max<size_t>(n, 1) - 1];
+  };
+  stats.p50_ns = rank(0.50);
+  stats.p99_ns = rank(0.99);
+  stats.max_ns = samples.back();
+  return stats;
+}
+
+template<typename T, typename F>
+static void
+writeArray(ostringstream& os, const vector<T>& items, F writeItem)
+{
+  os << "[";
+  auto first = true;
+  for (auto& item : items) {
+    if (!first) {
+      os << ",";
+    }
+    first = false;
+    writeItem(item);
+  }
+  os << "]";
+}
+
+static void
+writePhases(ostringstream& os, const vector<PhaseStats>& phases)
+{
+  writeArray(os, phases, [&](const PhaseStats& p) {
+    os << "{\"name\":" << jsonQuote(p.name) << ",\"offset_ns\":" << p.offset_ns
+       << ",\"duration_ns\":" << p.duration_ns << "}";
+  });
+}
+
+string
+Stats::toJson() const
+{
+  ostringstream os;
+  os << "{\"kernel\":" << jsonQuote(kernel) << ",\"status\":" << jsonQuote(status)
+     << ",\"phases\":";
+  writePhases(os, phases);
+
+  os << ",\"devices\":";
+  writeArray(os, devices, [&](const DeviceStats& d) {
+    os << "{\"id\":" << d.id << ",\"platform\":" << d.platform << ",\"device\":" << d.device
+       << ",\"quarantined\":" << (d.quarantined ? "true" : "false")
+       << ",\"failure\":" << jsonQuote(d.failure) << ",\"host\":" << (d.host ? "true" : "false")
+       << ",\"simulated\":" << (d.simulated ? "true" : "false")
+       << ",\"cpus\":" << jsonQuote(formatCpuList(d.cpus))
+       << ",\"works\":" << d.works
+       << ",\"works_size\":" << d.worksSize << ",\"events_dropped\":" << d.eventsDropped
+       << ",\"kernel_ns\":" << d.kernel_ns
+       << ",\"write_ns\":" << d.write_ns << ",\"read_ns\":" << d.read_ns
+       << ",\"overhead_ns\":" << d.overhead_ns << ",\"busy_ns\":" << d.busy_ns
+       << ",\"idle_ns\":" << d.idle_ns << ",\"finish_ns\":" << d.finish_ns
+       << ",\"lag_ns\":" << d.lag_ns << ",\"writes\":" << d.writes
+       << ",\"write_bytes\":" << d.writeBytes << ",\"write_gbps\":" << d.write_gbps
+       << ",\"reads\":" << d.reads << ",\"read_bytes\":" << d.readBytes
+       << ",\"read_gbps\":" << d.read_gbps << ",\"buffers\":";
+    writeArray(os, d.buffers, [&](const BufferStats& b) {
+      os << "{\"direction\":" << jsonQuote(b.direction) << ",\"index\":" << b.index
+         << ",\"bytes\":" << b.bytes << ",\"transfers\":" << b.transfers
+         << ",\"transferred_bytes\":" << b.transferredBytes << ",\"transfer_ns\":" << b.transfer_ns
+         << ",\"gbps\":" << b.gbps << "}";
+    });
+    os << ",\"phases\":";
+    writePhases(os, d.phases);
+    os << ",\"chunks\":";
+    writeArray(os, d.chunks, [&](const ChunkStats& c) {
+      os << "{\"offset\":" << c.offset << ",\"size\":" << c.size << ",\"ts_ns\":" << c.ts_ns
+         << ",\"duration_ns\":" << c.duration_ns << ",\"kernel_ns\":" << c.kernel_ns
+         << ",\"transfer_ns\":" << c.transfer_ns << "}";
+    });
+    os << "}";
+  });
+
+  os << ",\"scheduler\":{\"name\":" << jsonQuote(scheduler.name)
+     << ",\"chunks\":" << scheduler.chunks
+     << ",\"cpus\":" << jsonQuote(formatCpuList(scheduler.cpus)) << ",\"phases\":";
+  writePhases(os, scheduler.phases);
+  os << ",\"dispatches\":";
+  writeArray(os, scheduler.dispatches, [&](const Dispatch& d) {
+    os << "{\"ts_ns\":" << d.ts_ns << ",\"device\":" << d.device << ",\"offset\":" << d.offset
+       << ",\"size\":" << d.size << "}";
+  });
+  os << ",\"recoveries\":";
+  writeArray(os, scheduler.recoveries, [&](const Recovery& r) {
+    os << "{\"from\":" << r.from << ",\"to\":" << r.to << ",\"offset\":" << r.offset
+       << ",\"size\":" << r.size << "}";
+  });
+  os << ",\"handoff\":";
+  writeArray(os, scheduler.handoff, [&](const LatencyStats& l) {
+    os << "{\"name\":" << jsonQuote(l.name) << ",\"samples\":" << l.samples
+       << ",\"p50_ns\":" << l.p50_ns << ",\"p99_ns\":" << l.p99_ns << ",\"max_ns\":" << l.max_ns
+       << "}";
+  });
+  os << "}";
+
+  os << ",\"balance\":{\"makespan_ns\":" << balance.makespan_ns
+     << ",\"efficiency\":" << balance.efficiency << ",\"baseline_ns\":" << balance.baseline_ns
+     << ",\"baseline_measured\":" << (balance.baselineMeasured ? "true" : "false")
+     << ",\"speedup\":" << balance.speedup << "}";
+
+  os << ",\"completed\":";
+  writeArray(os, completed, [&](const tuple<size_t, size_t>& range) {
+    os << "{\"offset\":" << std::get<0>(range) << ",\"size\":" << std::get<1>(range) << "}";
+  });
+  os << "}";
+  return os.str();
+}
+
+string
+Stats::toCsv() const
+{
+  ostringstream os;
+  os << "thread,kind,name,offset,size,ts_ns,duration_ns\n";
+  auto writePhaseRows = [&](const string& thread, const vector<PhaseStats>& rows) {
+    for (auto& p : rows) {
+      os << thread << ",phase," << p.name << ",,," << p.offset_ns << "," << p.duration_ns << "\n";
+    }
+  };
+  writePhaseRows("runtime", phases);
+  writePhaseRows("scheduler", scheduler.phases);
+  for (auto& d : scheduler.dispatches) {
+    os << "scheduler,dispatch," << d.device << "," << d.offset << "," << d.size << "," << d.ts_ns
+       << ",\n";
+  }
+  for (auto& d : devices) {
+    auto thread = to_string(d.id);
+    writePhaseRows(thread, d.phases);
+    for (auto& c : d.chunks) {
+      os << thread << ",chunk,," << c.offset << "," << c.size << "," << c.ts_ns << ","
+         << c.duration_ns << "\n";
+    }
+  }
+  return os.str();
+}
+
+} // namespace ecl
@@ -0,0 +1,97 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+namespace ecl {
+
+ThreadPool::ThreadPool(size_t threads)
+  : mSemaDone(std::max<size_t>(threads, 2) - 1)
+  , mTask(nullptr)
+  , mOffset(0)
+  , mSize(0)
+  , mPart(0)
+  , mExit(false)
+  , mErrorLock(ATOMIC_FLAG_INIT)
+{
+  auto workers = std::max<size_t>(threads, 1) - 1;
+  for (size_t i = 0; i < workers; ++i) {
+    mSemaStart.push_back(std::make_unique<Semaphore>(1));
+  }
+  for (size_t i = 0; i < workers; ++i) {
+    mWorkers.push_back(thread(&ThreadPool::work, this, i + 1));
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  mExit = true;
+  for (auto& start : mSemaStart) {
+    start->notify(1);
+  }
+  for (auto& worker : mWorkers) {
+    worker.join();
+  }
+}
+
+void
+ThreadPool::parallelFor(size_t offset, size_t size, size_t granularity, const Task& task)
+{
+  auto threads = mWorkers.size() + 1;
+  granularity = std::max<size_t>(granularity, 1);
+  auto units = (size + granularity - 1) / granularity;
+  mTask = &task;
+  mOffset = offset;
+  mSize = size;
+  mPart = (units + threads - 1) / threads * granularity;
+  mError = nullptr;
+  for (auto& start : mSemaStart) { // the semaphores publish the part
+    start->notify(1);
+  }
+  runPart(0);
+  if (!mWorkers.empty()) {
+    mSemaDone.wait(mWorkers.size());
+  }
+  if (mError) {
+    std::rethrow_exception(mError);
+  }
+}
+
+void
+ThreadPool::work(size_t index)
+{
+  for (;;) {
+    mSemaStart[index - 1]->wait(1);
+    if (mExit) {
+      return;
+    }
+    runPart(index);
+    mSemaDone.notify(1);
+  }
+}
+
+void
+ThreadPool::runPart(size_t index)
+{
+  auto begin = std::min(mSize, index * mPart);
+  auto end = std::min(mSize, begin + mPart);
+  if (begin == end) {
+    return;
+  }
+  try {
+    (*mTask)(mOffset + begin, end - begin);
+  } catch (...) {
+    while (mErrorLock.test_and_set(std::memory_order_acquire)) {
+    }
+    if (!mError) {
+      mError = std::current_exception();
+    }
+    mErrorLock.clear(std::memory_order_release);
+  }
+}
+
+} // namespace ecl
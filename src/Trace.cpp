@@ -0,0 +1,79 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#include "Trace.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#include "Json.hpp"
+
+namespace ecl {
+
+// the format uses microseconds, keeping the nanoseconds as decimals
+static string
+toUs(size_t ns)
+{
+  char us[32];
+  snprintf(us, sizeof(us), "%zu.%03zu", ns / 1000, ns % 1000);
+  return us;
+}
+
+void
+Trace::setTrackName(int track, const string& name)
+{
+  mEvents.push_back("{\"ph\":\"M\",\"pid\":0,\"tid\":" + std::to_string(track) +
+                    ",\"name\":\"thread_name\",\"args\":{\"name\":" + jsonQuote(name) + "}}");
+}
+
+void
+Trace::addSpan(int track,
+               const string& name,
+               const string& category,
+               size_t tsNs,
+               size_t durationNs,
+               const string& args)
+{
+  mEvents.push_back("{\"ph\":\"X\",\"pid\":0,\"tid\":" + std::to_string(track) +
+                    ",\"name\":" + jsonQuote(name) + ",\"cat\":" + jsonQuote(category) +
+                    ",\"ts\":" + toUs(tsNs) + ",\"dur\":" + toUs(durationNs) + ",\"args\":{" +
+                    args + "}}");
+}
+
+void
+Trace::addInstant(int track,
+                  const string& name,
+                  const string& category,
+                  size_t tsNs,
+                  const string& args)
+{
+  mEvents.push_back("{\"ph\":\"i\",\"s\":\"t\",\"pid\":0,\"tid\":" + std::to_string(track) +
+                    ",\"name\":" + jsonQuote(name) + ",\"cat\":" + jsonQuote(category) +
+                    ",\"ts\":" + toUs(tsNs) + ",\"args\":{" + args + "}}");
+}
+
+void
+Trace::write(std::ostream& os) const
+{
+  os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+  auto len = mEvents.size();
+  for (size_t i = 0; i < len; ++i) {
+    os << mEvents[i] << (i + 1 < len ? ",\n" : "\n");
+  }
+  os << "]}\n";
+}
+
+void
+Trace::save(const string& path) const
+{
+  std::ofstream file(path);
+  if (!file) {
+    throw std::runtime_error("cannot open the trace file " + path);
+  }
+  write(file);
+}
+
+} // namespace ecl
@@ -5,10 +5,14 @@
  */
 #include "schedulers/Dynamic.hpp"
 
+#include <cassert>
 #include <tuple>
 
+#include "Affinity.hpp"
+#include "DecisionLog.hpp"
 #include "Device.hpp"
 #include "Scheduler.hpp"
+#include "Stats.hpp"
 
 #define ATOMIC 1
 // #define ATOMIC 0
@@ -18,22 +22,29 @@ namespace ecl {
 void
 fnThreadScheduler(DynamicScheduler& scheduler)
 {
-  auto time1 = std::chrono::system_clock::now().time_since_epoch();
+  scheduler.applyAffinity();
   scheduler.saveDuration(ActionType::schedulerStart);
   scheduler.saveDurationOffset(ActionType::schedulerStart);
   scheduler.preEnqueueWork();
+#if ECL_HANDOFF_PROFILING
+  scheduler.markWake();
+#endif
   while (scheduler.hasWork()) {
     auto moreReqs = true;
     do {
       auto device = scheduler.getNextRequest();
       if (device != nullptr) {
         scheduler.enqueueWork(device);
-        device->notifyWork();
+        scheduler.servedRequest();
       } else {
         moreReqs = false;
       }
     } while (moreReqs);
+    scheduler.enqueueIdleWork();
     scheduler.waitCallbacks();
+#if ECL_HANDOFF_PROFILING
+    scheduler.markWake();
+#endif
   }
   scheduler.notifyDevices();
   scheduler.saveDuration(ActionType::schedulerEnd);
@@ -41,21 +52,26 @@ fnThreadScheduler(DynamicScheduler& scheduler)
 }
 
 DynamicScheduler::DynamicScheduler(WorkSplit wsplit)
-  : mWorkSplit(wsplit)
+  : mSemaPinned(1)
+  , mDevicesAlive(0)
+  , mDispatches(ECL_EVENTS_CAPACITY)
+  , mDecisionWriter(nullptr)
+  , mCancelled(false)
+  , mChunksInFlight(0)
+  , mWorkSplit(wsplit)
   , mHasWork(false)
   , mSemaRequests(1)
   , mSemaCallbacks(1)
   , mChunksDone(0)
-  , mRequestsMax(0)
-  , mRequestsIdx(0)
-  , mRequestsIdxDone(0)
-  , mRequestsList(0, 0)
+  , mRequestsServed(0)
+  , mDurationActions(64)
+  , mDurationOffsetActions(64)
+#if ECL_HANDOFF_PROFILING
+  , mWakeNs(0)
+#endif
 {
-  mMutexDuration = new mutex();
-  mTimeInit = std::chrono::system_clock::now().time_since_epoch();
-  mTime = std::chrono::system_clock::now().time_since_epoch();
-  mDurationActions.reserve(8);       // NOTE: improve the reserve
-  mDurationOffsetActions.reserve(8); // trade-off memory/common usage
+  mTimeInit = std::chrono::steady_clock::now();
+  mTime = std::chrono::steady_clock::now();
 }
 
 DynamicScheduler::~DynamicScheduler()
@@ -79,12 +95,41 @@ DynamicScheduler::printStats()
 #else
   cout << "chunks: " << sum << "\n";
 #endif
+  Inspector::printRecoveries(mRecovered);
+  string reason = mCancelled ? "cancelled" : "no device survived";
+  for (auto& work : mRetries) {
+    cout << " lost " << work.mOffset << "+" << work.mSize << " (" << reason << ")\n";
+  }
+  if (mSizeRemaining > 0) {
+    cout << " lost " << mSizeGiven << "+" << mSizeRemaining << " (" << reason << ")\n";
+  }
   cout << "duration offsets from init:\n";
-  for (auto& t : mDurationOffsetActions) {
+  for (auto& t : mDurationOffsetActions.toVector()) {
     Inspector::printActionTypeDuration(std::get<1>(t), std::get<0>(t));
   }
 }
 
+SchedulerStats
+DynamicScheduler::getStats()
+{
+  SchedulerStats stats;
+  stats.name = "dynamic";
+  stats.cpus = mPlacement;
+#if ATOMIC
+  stats.chunks = mChunksDone;
+#else
+  stats.chunks = 0;
+  for (auto done : mChunkDone) {
+    stats.chunks += done;
+  }
+#endif
+  stats.phases = phasesFromOffsets(mDurationOffsetActions.toVector());
+  lock_guard<mutex> guard(mMutexWork);
+  stats.dispatches = mDispatches.toVector();
+  stats.recoveries = mRecovered;
+  return stats;
+}
+
 void
 DynamicScheduler::notifyDevices()
 {
@@ -99,19 +144,103 @@ DynamicScheduler::notifyDevices()
 void
 DynamicScheduler::saveDuration(ActionType action)
 {
-  lock_guard<mutex> lock(*mMutexDuration);
-  auto t2 = std::chrono::system_clock::now().time_since_epoch();
-  size_t diffMs = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - mTime).count();
-  mDurationActions.push_back(make_tuple(diffMs, action));
+  auto t2 = std::chrono::steady_clock::now();
+  size_t diffNs = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - mTime).count();
+  mDurationActions.push(make_tuple(diffNs, action));
   mTime = t2;
 }
+#if ECL_HANDOFF_PROFILING
+void
+DynamicScheduler::markWake()
+{
+  auto t2 = std::chrono::steady_clock::now();
+  mWakeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - mTimeInit).count();
+}
+#endif
+
+void
+DynamicScheduler::setTimeInit(std::chrono::steady_clock::time_point timeInit)
+{
+  mTimeInit = timeInit;
+}
+
+//! \brief Called with mMutexWork locked.
+void
+DynamicScheduler::saveDispatch(int device, size_t offset, size_t size)
+{
+  auto t2 = std::chrono::steady_clock::now();
+  size_t diffNs = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - mTimeInit).count();
+  Dispatch dispatch = { diffNs, device, offset, size };
+  mDispatches.push(dispatch);
+  if (mDecisionWriter != nullptr) {
+    mDecisionWriter->append(dispatch);
+  }
+}
+
+//! \brief Called with mMutexWork locked.
+void
+DynamicScheduler::saveRecovery(const Recovery& recovery)
+{
+  mRecovered.push_back(recovery);
+  if (mDecisionWriter != nullptr) {
+    mDecisionWriter->appendLost(recovery.from, recovery.offset, recovery.size);
+  }
+}
+
+void
+DynamicScheduler::setDecisionWriter(DecisionWriter* writer)
+{
+  lock_guard<mutex> guard(mMutexWork);
+  mDecisionWriter = writer;
+}
+
+//! \brief Slot of the `chunk`-th work of the device, free again once the previous lap completed.
+uint
+DynamicScheduler::slotIndex(uint id, uint chunk) const
+{
+  return id * ECL_DEVICE_PIPELINE + chunk % ECL_DEVICE_PIPELINE;
+}
+
+//! \brief Asserts (debug builds) that the chunk of the previous lap left the slot.
+void
+DynamicScheduler::claimSlot(uint index)
+{
+#ifndef NDEBUG
+  auto busy = mSlotsBusy[index].exchange(true, std::memory_order_acq_rel);
+  assert(!busy && "slot reused before its chunk was completed");
+#endif
+}
+
+//! \brief The chunk of the slot is completed or lost (after reading it).
+void
+DynamicScheduler::releaseSlot(uint index)
+{
+#ifndef NDEBUG
+  mSlotsBusy[index].store(false, std::memory_order_release);
+#endif
+}
+
+//! \brief The latest ECL_EVENTS_CAPACITY dispatches (older ones are dropped).
+vector<Dispatch>
+DynamicScheduler::getDispatches()
+{
+  lock_guard<mutex> guard(mMutexWork);
+  return mDispatches.toVector();
+}
+
+size_t
+DynamicScheduler::getDispatchesDropped()
+{
+  lock_guard<mutex> guard(mMutexWork);
+  return mDispatches.dropped();
+}
+
 void
 DynamicScheduler::saveDurationOffset(ActionType action)
 {
-  lock_guard<mutex> lock(*mMutexDuration);
-  auto t2 = std::chrono::system_clock::now().time_since_epoch();
-  size_t diffMs = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - mTimeInit).count();
-  mDurationOffsetActions.push_back(make_tuple(diffMs, action));
+  auto t2 = std::chrono::steady_clock::now();
+  size_t diffNs = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - mTimeInit).count();
+  mDurationOffsetActions.push(make_tuple(diffNs, action));
 }
 
 void
@@ -190,7 +319,8 @@ DynamicScheduler::setOutPattern(uint outWorkitems, uint outPositions)
 bool
 DynamicScheduler::hasWork()
 {
-  return mSizeRemainingCompleted != 0;
+  auto cancelled = mCancelled && mChunksInFlight == 0;
+  return mSizeRemainingCompleted != 0 && mDevicesAlive > 0 && !cancelled;
 }
 
 void
@@ -243,16 +373,15 @@ DynamicScheduler::setDevices(vector<Device*>&& devices)
   mChunkGiven = vector<uint>(mNumDevices, 0);
   mChunkDone = vector<uint>(mNumDevices, 0);
 
-  mRequestsMax = mNumDevices * 2;
-  mRequestsList = vector<uint>(mRequestsMax, 0);
-  mQueueWork.reserve(65536);
-
-  mQueueIdWork.reserve(mNumDevices);
-  mQueueIdWork = vector<vector<uint>>(mNumDevices, vector<uint>());
-  for (auto& qIdWork : mQueueIdWork) {
-    qIdWork.reserve(65536);
-  }
-  mDevicesWorking = 0;
+  mRequestsQueue = MPSCQueue<uint>(mNumDevices * 2);
+  mSlots = vector<Work>(mNumDevices * ECL_DEVICE_PIPELINE);
+  mSlotsBusy = vector<atomic<bool>>(mSlots.size());
+  mFailed = vector<bool>(mNumDevices, false);
+  mDevicesAlive = mNumDevices;
+  mIdleDevices.reserve(mNumDevices);
+  mDispatches.clear();
+  mCompleted.clear();
+  mCompleted.reserve(mSlots.size() + 1);
 }
 
 void
@@ -263,27 +392,91 @@ void
 DynamicScheduler::start()
 {
   mThread = thread(fnThreadScheduler, std::ref(*this));
+  mSemaPinned.wait(1);
+  if (!mAffinityError.empty()) {
+    throw runtime_error(mAffinityError);
+  }
+}
+
+/**
+ * \brief Pins the calling (scheduler) thread, so it never runs unpinned, and keeps its placement.
+ * A failure leaves it floating and is thrown by `start`.
+ */
+void
+DynamicScheduler::applyAffinity()
+{
+  if (!mCpus.empty()) {
+    try {
+      setCurrentThreadAffinity(mCpus);
+    } catch (std::exception& e) {
+      mAffinityError = e.what();
+    }
+  }
+  mPlacement = getCurrentThreadAffinity();
+  mSemaPinned.notify(1);
 }
 
+/**
+ * \brief Gives the next package to the device, preferring the work of failed devices.
+ *
+ * Without work to give, the device is parked until the end of the run, as it may still receive
+ * the work of a device failing later.
+ */
 void
 DynamicScheduler::enqueueWork(Device* device)
 {
   int id = device->getID();
-  if (mSizeRemaining > 0) {
-
-    size_t size = mSizeGiven == 0 ? mWorkLast : mWorksize;
-    size_t index = -1;
-    {
-      lock_guard<mutex> guard(mMutexWork);
+  auto given = false;
+  {
+    lock_guard<mutex> guard(mMutexWork);
+    if (mFailed[id] || mCancelled) {
+      given = true; // wakes it up to leave
+    } else if (!mRetries.empty()) {
+      Work retry = mRetries.back();
+      mRetries.pop_back();
+      saveRecovery({ retry.mDeviceId, id, retry.mOffset, retry.mSize });
+      auto index = slotIndex(id, mChunkTodo[id]++);
+      claimSlot(index);
+      mSlots[index] = Work(id, retry.mOffset, retry.mSize, mOutWorkitems, mOutPositions);
+      mChunksInFlight++;
+      saveDispatch(id, retry.mOffset, retry.mSize);
+      given = true;
+    } else if (mSizeRemaining > 0) {
+      size_t size = mSizeGiven == 0 ? mWorkLast : mWorksize;
       size_t offset = mSizeGiven;
       mSizeRemaining -= size;
       mSizeGiven += size;
-      index = mQueueWork.size();
-      mQueueWork.push_back(Work(id, offset, size, mOutWorkitems, mOutPositions));
-      mQueueIdWork[id].push_back(index);
-      mChunkTodo[id]++;
+      auto index = slotIndex(id, mChunkTodo[id]++);
+      claimSlot(index);
+      mSlots[index] = Work(id, offset, size, mOutWorkitems, mOutPositions);
+      mChunksInFlight++;
+      saveDispatch(id, offset, size);
+      given = true;
     }
   }
+  if (given) {
+#if ECL_HANDOFF_PROFILING
+    device->markHandOff(HandOffStep::Wake, mWakeNs);
+    device->markHandOff(HandOffStep::Enqueued);
+#endif
+    device->notifyWork();
+  } else {
+    mIdleDevices.push_back(device);
+  }
+}
+
+void
+DynamicScheduler::enqueueIdleWork()
+{
+  if (mIdleDevices.empty()) {
+    return;
+  }
+  vector<Device*> idle;
+  idle.reserve(mNumDevices);
+  std::swap(idle, mIdleDevices);
+  for (auto device : idle) {
+    enqueueWork(device);
+  }
 }
 
 void
@@ -295,8 +488,7 @@ DynamicScheduler::requestWork(Device* device)
 {
 #if ATOMIC == 1
   if (mSizeRemainingCompleted > 0) {
-    auto idx = mRequestsIdx++ % mRequestsMax;
-    mRequestsList[idx] = device->getID() + 1;
+    pushRequest(device->getID());
   }
 #else
   {
@@ -313,20 +505,28 @@ void
 DynamicScheduler::callback(int queueIndex)
 {
 #if ATOMIC == 1
-  Work work = mQueueWork[queueIndex];
+  Work work = mSlots[queueIndex]; // before the request reuses the slot
+  releaseSlot(queueIndex);
   int id = work.mDeviceId;
+  {
+    lock_guard<mutex> guard(mMutexCompleted);
+    insertRange(mCompleted, work.mOffset, work.mSize);
+  }
   mChunksDone++;
+  mChunksInFlight--;
   mSizeRemainingCompleted -= work.mSize;
   if (mSizeRemainingCompleted > 0) {
-    auto idx = mRequestsIdx++ % mRequestsMax;
-    mRequestsList[idx] = id + 1;
+    pushRequest(id);
   }
 #else
   {
     lock_guard<mutex> guard(mMutexWork);
-    Work work = mQueueWork[queue_index];
+    Work work = mSlots[queueIndex];
+    releaseSlot(queueIndex);
     int id = work.mDeviceId;
+    insertRange(mCompleted, work.mOffset, work.mSize);
     mChunkDone[id]++;
+    mChunksInFlight--;
     mSizeRemainingCompleted -= work.mSize;
     if (mSizeRemainingCompleted) {
       mRequests.push(id);
@@ -336,17 +536,77 @@ DynamicScheduler::callback(int queueIndex)
   notifyCallbacks();
 }
 
+void
+DynamicScheduler::failWork(Device* device, int queueIndex)
+{
+  int id = device->getID();
+  {
+    lock_guard<mutex> guard(mMutexWork);
+    if (!mFailed[id]) {
+      mFailed[id] = true;
+      mDevicesAlive--;
+    }
+    if (queueIndex >= 0) {
+      Work work = mSlots[queueIndex];
+      releaseSlot(queueIndex);
+      mRetries.push_back(work);
+      mSizeRemainingGiven += work.mSize;
+      mChunksInFlight--;
+    }
+    while (mChunkGiven[id] < mChunkTodo[id]) { // enqueued but not started
+      auto index = slotIndex(id, mChunkGiven[id]++);
+      mRetries.push_back(mSlots[index]);
+      releaseSlot(index);
+      mChunksInFlight--;
+    }
+  }
+  device->notifyWork();
+  notifyCallbacks();
+}
+
+void
+DynamicScheduler::cancel()
+{
+  mCancelled = true;
+  notifyCallbacks();
+}
+
+size_t
+DynamicScheduler::getQueueDepth()
+{
+  return mChunksInFlight + mRequestsQueue.size(); // the size is clamped, never wraps
+}
+
+size_t
+DynamicScheduler::getUnservedRequests()
+{
+  auto served = mRequestsServed.load(); // first: the requests are pushed before being served
+  return mRequestsQueue.pushed() - served;
+}
+
+vector<tuple<size_t, size_t>>
+DynamicScheduler::getCompletedRanges()
+{
+  lock_guard<mutex> guard(mMutexCompleted);
+  return mCompleted;
+}
+
 int
 DynamicScheduler::getWorkIndex(Device* device)
 {
   lock_guard<mutex> guard(mMutexWork);
   int id = device->getID();
-  if (mSizeRemainingGiven > 0 && mChunkTodo[id] > mChunkGiven[id]) {
-    uint next = 0;
-    int index = -1;
-    next = mChunkGiven[id]++;
-    mSizeRemainingGiven -= mWorksize;
-    index = mQueueIdWork[id][next];
+  if (mCancelled && mChunkTodo[id] > mChunkGiven[id]) { // enqueued but not started
+    mChunksInFlight -= mChunkTodo[id] - mChunkGiven[id];
+    while (mChunkGiven[id] < mChunkTodo[id]) {
+      releaseSlot(slotIndex(id, mChunkGiven[id]++));
+    }
+    notifyCallbacks();
+    return -1;
+  }
+  if (mSizeRemainingGiven > 0 && !mFailed[id] && mChunkTodo[id] > mChunkGiven[id]) {
+    int index = slotIndex(id, mChunkGiven[id]++);
+    mSizeRemainingGiven -= mSlots[index].mSize;
     return index;
   } else {
     return -1;
@@ -357,7 +617,7 @@ Work
 DynamicScheduler::getWork(uint queueIndex)
 {
   lock_guard<mutex> guard(mMutexWork);
-  return mQueueWork[queueIndex];
+  return mSlots[queueIndex];
 }
 
 Device*
@@ -365,12 +625,9 @@ DynamicScheduler::getNextRequest()
 {
   Device* dev = nullptr;
 #if ATOMIC == 1
-  uint idxDone = mRequestsIdxDone % mRequestsMax;
-  uint id = mRequestsList[idxDone];
-  if (id > 0) {
-    dev = mDevices[id - 1];
-    mRequestsList[idxDone] = 0;
-    mRequestsIdxDone++;
+  uint id;
+  if (mRequestsQueue.pop(id)) {
+    dev = mDevices[id];
   }
 #else
   lock_guard<mutex> guard(mMutexWork);
@@ -382,4 +639,22 @@ DynamicScheduler::getNextRequest()
 #endif
   return dev;
 }
+
+/**
+ * \brief A device has a request queued at most (its first one or the callback of its chunk), so
+ * the queue of twice the devices is not full. If it were, the producer waits for the consumer.
+ */
+void
+DynamicScheduler::pushRequest(uint id)
+{
+  while (!mRequestsQueue.push(id)) {
+    std::this_thread::yield();
+  }
+}
+
+void
+DynamicScheduler::servedRequest()
+{
+  mRequestsServed++;
+}
 } // namespace ecl
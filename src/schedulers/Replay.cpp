@@ -0,0 +1,156 @@
+/**
+ * Copyright (c) 2018    ATC (University of Cantabria) <nozalr@unican.es>
+ * This file is part of EngineCL which is released under MIT License.
+ * See file LICENSE for full license details.
+ */
+#include "schedulers/Replay.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+#include "Device.hpp"
+#include "Stats.hpp"
+
+namespace ecl {
+
+/**
+ * \brief The dispatches of `log` should cover its problem once: they are sorted by offset and
+ * every range starts where the previous one ends.
+ */
+ReplayScheduler::ReplayScheduler(const DecisionLog& log)
+  : StaticScheduler(WorkSplit::By_Devices)
+  , mLog(log)
+{
+  vector<tuple<size_t, size_t>> ranges;
+  ranges.reserve(mLog.dispatches.size());
+  for (auto& d : mLog.dispatches) {
+    ranges.push_back(make_tuple(d.offset, d.size));
+  }
+  std::sort(begin(ranges), end(ranges));
+  size_t covered = 0;
+  for (auto& range : ranges) {
+    size_t offset, size;
+    tie(offset, size) = range;
+    if (offset < covered) {
+      throw runtime_error("the decision log dispatches the range at " + to_string(offset) +
+                          " more than once");
+    }
+    if (offset > covered) {
+      break;
+    }
+    covered = offset + size;
+  }
+  if (covered != mLog.size) {
+    throw runtime_error("the decision log does not cover the problem size " +
+                        to_string(mLog.size));
+  }
+}
+
+void
+ReplayScheduler::printStats()
+{
+  auto sum = 0;
+  for (auto done : mChunkDone) {
+    sum += done;
+  }
+  cout << "ReplayScheduler:\n";
+  cout << "chunks: " << sum << " (" << mLog.dispatches.size() << " recorded)\n";
+  Inspector::printRecoveries(mRecovered);
+  cout << "duration offsets from init:\n";
+  for (auto& t : mDurationOffsetActions.toVector()) {
+    Inspector::printActionTypeDuration(std::get<1>(t), std::get<0>(t));
+  }
+}
+
+SchedulerStats
+ReplayScheduler::getStats()
+{
+  auto stats = StaticScheduler::getStats();
+  stats.name = "replay";
+  return stats;
+}
+
+void
+ReplayScheduler::setTotalSize(size_t size)
+{
+  if (size != mLog.size) {
+    throw runtime_error("decision log of size " + to_string(mLog.size) + " replayed with size " +
+                        to_string(size));
+  }
+  StaticScheduler::setTotalSize(size);
+}
+
+void
+ReplayScheduler::setDevices(vector<Device*>&& devices)
+{
+  for (auto& d : mLog.dispatches) {
+    if (d.device < 0 || static_cast<size_t>(d.device) >= devices.size()) {
+      throw runtime_error("the decision log uses device " + to_string(d.device) + " of " +
+                          to_string(devices.size()));
+    }
+  }
+  StaticScheduler::setDevices(move(devices));
+  mPackageGiven = vector<bool>(mNumDevices, true); // only the recorded chunks
+  mRequested = vector<bool>(mNumDevices, false);
+  mQueueWork.reserve(mLog.dispatches.size());
+  mCompleted.reserve(mLog.dispatches.size());
+  mDispatches.reserve(mLog.dispatches.size());
+}
+
+//! \brief Queues the recorded chunks of every device.
+void
+ReplayScheduler::preEnqueueWork()
+{
+  for (auto& d : mLog.dispatches) {
+    uint index = mQueueWork.size();
+    mQueueWork.push_back(Work(d.device, d.offset, d.size, mOutWorkitems, mOutPositions));
+    mQueueIdWork[d.device].push_back(index);
+    mChunkTodo[d.device]++;
+  }
+  mChunksPending = mQueueWork.size();
+}
+
+void
+ReplayScheduler::enqueueWork(Device* /* device */)
+{}
+
+/**
+ * \brief Wakes the device once per chunk queued. Without chunks, it waits until the end of the run,
+ * as it may receive the chunks of a failed device.
+ */
+void
+ReplayScheduler::requestWork(Device* device)
+{
+  int id = device->getID();
+  lock_guard<mutex> guard(mMutexWork);
+  mRequested[id] = true;
+  for (uint i = mChunkGiven[id]; i < mChunkTodo[id]; ++i) {
+    device->notifyWork();
+  }
+}
+
+//! \brief The dispatch is saved when the chunk is taken, as the recorded ones.
+void
+ReplayScheduler::notifyRecovered(int to, const Work& /* work */)
+{
+  if (mRequested[to]) { // otherwise, woken by its request
+    mDevices[to]->notifyWork();
+  }
+}
+
+int
+ReplayScheduler::getWorkIndex(Device* device)
+{
+  int id = device->getID();
+  lock_guard<mutex> guard(mMutexWork);
+  if (!mFailed[id] && mChunkGiven[id] < mChunkTodo[id]) {
+    auto index = mQueueIdWork[id][mChunkGiven[id]++];
+    auto& work = mQueueWork[index];
+    saveDispatch(id, work.mOffset, work.mSize);
+    return index;
+  } else {
+    return -1;
+  }
+}
+
+} // namespace ecl
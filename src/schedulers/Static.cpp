@@ -7,32 +7,36 @@
 
 #include <tuple>
 
+#include "Affinity.hpp"
+#include "DecisionLog.hpp"
 #include "Device.hpp"
+#include "Stats.hpp"
 
 namespace ecl {
 
 void
 fnThreadScheduler(StaticScheduler& scheduler)
 {
-  auto time1 = std::chrono::system_clock::now().time_since_epoch();
+  scheduler.applyAffinity();
   scheduler.saveDuration(ActionType::schedulerStart);
   scheduler.saveDurationOffset(ActionType::schedulerStart);
-  scheduler.preEnqueueWork();
   scheduler.waitCallbacks();
   scheduler.saveDuration(ActionType::schedulerEnd);
   scheduler.saveDurationOffset(ActionType::schedulerEnd);
 }
 
 StaticScheduler::StaticScheduler(WorkSplit wsplit)
-  : mSema(1)
+  : mSemaPinned(1)
+  , mSema(1)
   , mHasWork(false)
+  , mDecisionWriter(nullptr)
+  , mCancelled(false)
   , mWorkSplit(wsplit)
+  , mDurationActions(64)
+  , mDurationOffsetActions(64)
 {
-  mMutexDuration = new mutex();
-  mTimeInit = std::chrono::system_clock::now().time_since_epoch();
-  mTime = std::chrono::system_clock::now().time_since_epoch();
-  mDurationActions.reserve(8);       // NOTE: improve the reserve
-  mDurationOffsetActions.reserve(8); // trade-off memory/common usage
+  mTimeInit = std::chrono::steady_clock::now();
+  mTime = std::chrono::steady_clock::now();
 }
 
 StaticScheduler::~StaticScheduler()
@@ -52,12 +56,30 @@ StaticScheduler::printStats()
   }
   cout << "StaticScheduler:\n";
   cout << "chunks: " << sum << "\n";
+  Inspector::printRecoveries(mRecovered);
   cout << "duration offsets from init:\n";
-  for (auto& t : mDurationOffsetActions) {
+  for (auto& t : mDurationOffsetActions.toVector()) {
     Inspector::printActionTypeDuration(std::get<1>(t), std::get<0>(t));
   }
 }
 
+SchedulerStats
+StaticScheduler::getStats()
+{
+  SchedulerStats stats;
+  stats.name = "static";
+  stats.cpus = mPlacement;
+  stats.phases = phasesFromOffsets(mDurationOffsetActions.toVector());
+  lock_guard<mutex> guard(mMutexWork);
+  stats.chunks = 0;
+  for (auto done : mChunkDone) {
+    stats.chunks += done;
+  }
+  stats.dispatches = mDispatches;
+  stats.recoveries = mRecovered;
+  return stats;
+}
+
 void
 StaticScheduler::waitCallbacks()
 {
@@ -107,7 +129,11 @@ StaticScheduler::setDevices(vector<Device*>&& devices)
   mChunkDone = vector<uint>(mNumDevices, 0);
   mQueueIdWork.reserve(mNumDevices);
   mQueueIdWork = vector<vector<uint>>(mNumDevices, vector<uint>());
-  mDevicesWorking = 0;
+  mPackageGiven = vector<bool>(mNumDevices, false);
+  mFailed = vector<bool>(mNumDevices, false);
+  mChunksPending = 0;
+  mCompleted.reserve(mNumDevices);
+  mDispatches.reserve(mNumDevices);
 }
 
 void
@@ -146,19 +172,52 @@ StaticScheduler::splitWork(size_t size, float prop, size_t bound)
 void
 StaticScheduler::saveDuration(ActionType action)
 {
-  lock_guard<mutex> lock(*mMutexDuration);
-  auto t2 = std::chrono::system_clock::now().time_since_epoch();
-  size_t diffMs = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - mTime).count();
-  mDurationActions.push_back(make_tuple(diffMs, action));
+  auto t2 = std::chrono::steady_clock::now();
+  size_t diffNs = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - mTime).count();
+  mDurationActions.push(make_tuple(diffNs, action));
   mTime = t2;
 }
+void
+StaticScheduler::setTimeInit(std::chrono::steady_clock::time_point timeInit)
+{
+  mTimeInit = timeInit;
+}
+
+//! \brief Called with mMutexWork locked.
+void
+StaticScheduler::saveDispatch(int device, size_t offset, size_t size)
+{
+  auto t2 = std::chrono::steady_clock::now();
+  size_t diffNs = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - mTimeInit).count();
+  mDispatches.push_back({ diffNs, device, offset, size });
+  if (mDecisionWriter != nullptr) {
+    mDecisionWriter->append(mDispatches.back());
+  }
+}
+
+//! \brief Called with mMutexWork locked.
+void
+StaticScheduler::saveRecovery(const Recovery& recovery)
+{
+  mRecovered.push_back(recovery);
+  if (mDecisionWriter != nullptr) {
+    mDecisionWriter->appendLost(recovery.from, recovery.offset, recovery.size);
+  }
+}
+
+void
+StaticScheduler::setDecisionWriter(DecisionWriter* writer)
+{
+  lock_guard<mutex> guard(mMutexWork);
+  mDecisionWriter = writer;
+}
+
 void
 StaticScheduler::saveDurationOffset(ActionType action)
 {
-  lock_guard<mutex> lock(*mMutexDuration);
-  auto t2 = std::chrono::system_clock::now().time_since_epoch();
-  size_t diffMs = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - mTimeInit).count();
-  mDurationOffsetActions.push_back(make_tuple(diffMs, action));
+  auto t2 = std::chrono::steady_clock::now();
+  size_t diffNs = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - mTimeInit).count();
+  mDurationOffsetActions.push(make_tuple(diffNs, action));
 }
 
 void
@@ -199,32 +258,55 @@ StaticScheduler::calcProportions()
 void
 StaticScheduler::start()
 {
+  // proportions ready before any device can request its package
+  preEnqueueWork();
   mThread = thread(fnThreadScheduler, std::ref(*this));
+  mSemaPinned.wait(1);
+  if (!mAffinityError.empty()) {
+    throw runtime_error(mAffinityError);
+  }
+}
+
+/**
+ * \brief Pins the calling (scheduler) thread, so it never runs unpinned, and keeps its placement.
+ * A failure leaves it floating and is thrown by `start`.
+ */
+void
+StaticScheduler::applyAffinity()
+{
+  if (!mCpus.empty()) {
+    try {
+      setCurrentThreadAffinity(mCpus);
+    } catch (std::exception& e) {
+      mAffinityError = e.what();
+    }
+  }
+  mPlacement = getCurrentThreadAffinity();
+  mSemaPinned.notify(1);
 }
 
 void
 StaticScheduler::enqueueWork(Device* device)
 {
   int id = device->getID();
-  if (mChunkTodo[id] == 0) {
+  lock_guard<mutex> guard(mMutexWork);
+  if (!mPackageGiven[id]) {
+    mPackageGiven[id] = true;
     auto prop = mProportions[id];
     size_t size, offset;
     tie(size, offset) = prop;
-    uint index;
-    {
-      lock_guard<mutex> guard(mMutexWork);
-      index = mQueueWork.size();
-      mQueueWork.push_back(Work(id, offset, size, mOutWorkitems, mOutPositions));
-    }
+    uint index = mQueueWork.size();
+    mQueueWork.push_back(Work(id, offset, size, mOutWorkitems, mOutPositions));
     mQueueIdWork[id].push_back(index);
     mChunkTodo[id]++;
+    saveDispatch(id, offset, size);
   }
 }
 
 void
 StaticScheduler::preEnqueueWork()
 {
-  mDevicesWorking = mNumDevices;
+  mChunksPending = mNumDevices;
   calcProportions();
 }
 
@@ -235,41 +317,146 @@ StaticScheduler::requestWork(Device* device)
   device->notifyWork();
 }
 
+/**
+ * \brief Releases the devices once every package is completed (or lost).
+ *
+ * The devices wait until the end, as they may receive the packages of a failed device.
+ */
+void
+StaticScheduler::finish()
+{
+  for (auto device : mDevices) {
+    device->notifyWork();
+    device->notifyEvent();
+  }
+  notifyCallbacks();
+}
+
 void
 StaticScheduler::callback(int queueIndex)
 {
-  {
-    lock_guard<mutex> guard(mMutexWork);
-    Work work = mQueueWork[queueIndex];
-    int id = work.mDeviceId;
-    mChunkDone[id]++;
-    if (mChunkDone[id] == 1) {
-      Device* device = mDevices[id];
-      mDevicesWorking--;
-      device->notifyWork();
-      device->notifyEvent();
-      if (mDevicesWorking == 0) {
-        notifyCallbacks();
-      }
-    }
+  lock_guard<mutex> guard(mMutexWork);
+  Work work = mQueueWork[queueIndex];
+  int id = work.mDeviceId;
+  mCompleted.push_back(make_tuple(work.mOffset, work.mSize));
+  mChunkDone[id]++;
+  mChunksPending--;
+  if (mChunksPending == 0) {
+    finish();
   }
 }
 
 int
-StaticScheduler::getWorkIndex(Device* device)
+StaticScheduler::getSurvivor()
+{
+  int survivor = -1;
+  uint pending = 0;
+  for (uint i = 0; i < mNumDevices; ++i) {
+    if (!mFailed[i] && (survivor == -1 || (mChunkTodo[i] - mChunkDone[i]) < pending)) {
+      survivor = i;
+      pending = mChunkTodo[i] - mChunkDone[i];
+    }
+  }
+  return survivor;
+}
+
+void
+StaticScheduler::notifyRecovered(int to, const Work& work)
+{
+  saveDispatch(to, work.mOffset, work.mSize);
+  mDevices[to]->notifyWork();
+}
+
+void
+StaticScheduler::failWork(Device* device, int queueIndex)
 {
   int id = device->getID();
-  if (mHasWork) {
-    if (mChunkGiven[id] == 0) {
-      uint next = 0;
-      {
-        lock_guard<mutex> guard(mMutexWork);
-        next = mChunkGiven[id]++;
-      }
-      return mQueueIdWork[id][next];
+  lock_guard<mutex> guard(mMutexWork);
+  mFailed[id] = true;
+
+  vector<Work> lost;
+  if (!mPackageGiven[id]) {
+    mPackageGiven[id] = true;
+    size_t size, offset;
+    tie(size, offset) = mProportions[id];
+    lost.push_back(Work(id, offset, size, mOutWorkitems, mOutPositions));
+  }
+  if (queueIndex >= 0) {
+    lost.push_back(mQueueWork[queueIndex]);
+  }
+  while (mChunkGiven[id] < mChunkTodo[id]) {
+    lost.push_back(mQueueWork[mQueueIdWork[id][mChunkGiven[id]++]]);
+  }
+
+  for (auto& work : lost) {
+    int to = mCancelled ? -1 : getSurvivor();
+    saveRecovery({ id, to, work.mOffset, work.mSize });
+    if (to < 0) {
+      mChunksPending--;
     } else {
-      return -1;
+      uint index = mQueueWork.size();
+      mQueueWork.push_back(Work(to, work.mOffset, work.mSize, mOutWorkitems, mOutPositions));
+      mQueueIdWork[to].push_back(index);
+      mChunkTodo[to]++;
+      notifyRecovered(to, mQueueWork[index]);
     }
+  }
+
+  device->notifyWork();
+  if (mChunksPending == 0) {
+    finish();
+  }
+}
+
+void
+StaticScheduler::cancel()
+{
+  lock_guard<mutex> guard(mMutexWork);
+  if (mCancelled) {
+    return;
+  }
+  mCancelled = true;
+  uint dropped = 0;
+  for (uint id = 0; id < mNumDevices; ++id) {
+    if (!mPackageGiven[id]) {
+      mPackageGiven[id] = true;
+      dropped++;
+    }
+    dropped += mChunkTodo[id] - mChunkGiven[id]; // enqueued but not started
+    mChunkGiven[id] = mChunkTodo[id];
+  }
+  mChunksPending -= dropped;
+  if (dropped > 0 && mChunksPending == 0) {
+    finish();
+  }
+}
+
+size_t
+StaticScheduler::getQueueDepth()
+{
+  return mChunksPending;
+}
+
+size_t
+StaticScheduler::getUnservedRequests()
+{
+  return 0; // served in the caller
+}
+
+vector<tuple<size_t, size_t>>
+StaticScheduler::getCompletedRanges()
+{
+  lock_guard<mutex> guard(mMutexWork);
+  return mergeRanges(mCompleted);
+}
+
+int
+StaticScheduler::getWorkIndex(Device* device)
+{
+  int id = device->getID();
+  lock_guard<mutex> guard(mMutexWork);
+  if (mHasWork && !mFailed[id] && mChunkGiven[id] < mChunkTodo[id]) {
+    return mQueueIdWork[id][mChunkGiven[id]++];
   } else {
     return -1;
   }
@@ -278,6 +465,7 @@ StaticScheduler::getWorkIndex(Device* device)
 Work
 StaticScheduler::getWork(uint queueIndex)
 {
+  lock_guard<mutex> guard(mMutexWork);
   return mQueueWork[queueIndex];
 }
 
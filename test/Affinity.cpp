@@ -0,0 +1,69 @@
+#include "./tests.hpp"
+
+#include "EngineCL.hpp"
+
+using namespace std;
+
+TEST_CASE("Affinity", "[Affinity]")
+{
+  SECTION("CPU lists are parsed and formatted as in sysfs")
+  {
+    REQUIRE(ecl::parseCpuList("0-3, 8,10-11\n") == vector<int>({ 0, 1, 2, 3, 8, 10, 11 }));
+    REQUIRE(ecl::parseCpuList("").empty());
+    REQUIRE_THROWS_WITH(ecl::parseCpuList("3-1"), Catch::Contains("invalid CPU list"));
+    REQUIRE_THROWS_WITH(ecl::parseCpuList("a"), Catch::Contains("invalid CPU list"));
+    REQUIRE(ecl::formatCpuList({ 11, 0, 1, 2, 3, 8, 10, 2 }) == "0-3,8,10-11");
+    REQUIRE(ecl::formatCpuList({}).empty());
+    REQUIRE_THROWS_WITH(ecl::nodeCpus(-1), Catch::Contains("unknown NUMA node"));
+  }
+
+  SECTION("threads are pinned and their placement is read back")
+  {
+    auto available = ecl::availableCpus();
+    REQUIRE(!available.empty());
+    Semaphore done(1);
+    thread t([&] { done.wait(1); });
+    ecl::setThreadAffinity(t, { available.back() });
+    REQUIRE(ecl::getThreadAffinity(t) == vector<int>({ available.back() }));
+    ecl::setThreadAffinity(t, {}); // floats again
+    REQUIRE(ecl::getThreadAffinity(t) == available);
+    REQUIRE_THROWS_WITH(ecl::setThreadAffinity(t, { -1 }), Catch::Contains("invalid CPU"));
+    done.notify(1);
+    t.join();
+    REQUIRE(ecl::getThreadAffinity(t).empty());
+  }
+
+  SECTION("the runtime pins the device and scheduler threads")
+  {
+    auto cpu = ecl::availableCpus().front();
+    ecl::AffinityPolicy policy;
+    policy.setScheduler({ cpu });
+    policy.setDevice(1, { cpu });
+    policy.setExcludeFromCpuDevices(true);
+    REQUIRE(policy.reservedCpus() == vector<int>({ cpu }));
+    REQUIRE(policy.getDevice(0).empty());
+
+    ecl::DynamicScheduler sched;
+    vector<ecl::Device> devices;
+    devices.emplace_back(ecl::Device(99, 0));
+    devices.emplace_back(ecl::Device(99, 1));
+    auto out = make_shared<vector<int>>(1024);
+    ecl::Runtime runtime(move(devices), 1024, 128);
+    runtime.setScheduler(&sched);
+    runtime.setOutBuffer(out);
+    runtime.setKernel("__kernel void k(){}", "k");
+
+    ecl::AffinityPolicy unavailable;
+    unavailable.setScheduler({ ecl::availableCpus().back() + 1 });
+    REQUIRE_THROWS_WITH(runtime.setAffinity(unavailable), Catch::Contains("not available"));
+
+    runtime.setAffinity(policy);
+    REQUIRE_THROWS_WITH(runtime.run(), Catch::Contains("every device failed"));
+    auto stats = runtime.stats();
+    REQUIRE(stats.devices[0].cpus == ecl::availableCpus());
+    REQUIRE(stats.devices[1].cpus == vector<int>({ cpu }));
+    REQUIRE(stats.scheduler.cpus == vector<int>({ cpu }));
+    REQUIRE(stats.toJson().find("\"cpus\":\"" + to_string(cpu) + "\"") != string::npos);
+    REQUIRE_THROWS_WITH(runtime.setAffinity(policy), Catch::Contains("before prepare"));
+  }
+}
@@ -0,0 +1,59 @@
+#include "./tests.hpp"
+
+#include "Calibration.hpp"
+
+using namespace std;
+
+ecl::DeviceProfile
+profile(int id, double writeSeconds, double kernelSeconds)
+{
+  ecl::DeviceProfile p;
+  p.id = id;
+  p.platform = id;
+  p.device = 0;
+  p.probeSize = 1000;
+  p.writeBytes = 1000;
+  p.writeSeconds = writeSeconds;
+  p.launchSeconds = 0.0;
+  p.kernelSeconds = kernelSeconds;
+  p.readBytes = 1000;
+  p.readSeconds = 0.0;
+  return p;
+}
+
+TEST_CASE("Calibration", "[Calibration]")
+{
+  SECTION("equal devices share the work in halves")
+  {
+    auto plan = ecl::planDevices({ profile(0, 0.0, 1.0), profile(1, 0.0, 1.0) }, 1000);
+    REQUIRE(plan.devices == vector<int>({ 0, 1 }));
+    REQUIRE(plan.proportions[0] == Approx(0.5).margin(1e-5));
+    REQUIRE(plan.proportions[1] == Approx(0.5).margin(1e-5));
+    REQUIRE(plan.makespan == Approx(0.5).margin(1e-9));
+  }
+
+  SECTION("a device 3 times faster receives 3/4 of the work")
+  {
+    auto plan = ecl::planDevices({ profile(0, 0.0, 3.0), profile(1, 0.0, 1.0) }, 1000);
+    REQUIRE(plan.devices == vector<int>({ 0, 1 }));
+    REQUIRE(plan.proportions[0] == Approx(0.25).margin(1e-5));
+    REQUIRE(plan.proportions[1] == Approx(0.75).margin(1e-5));
+  }
+
+  SECTION("a device whose transfer exceeds the makespan is left out")
+  {
+    auto plan = ecl::planDevices({ profile(0, 5.0, 1.0), profile(1, 0.0, 1.0) }, 1000);
+    REQUIRE(plan.devices == vector<int>({ 1 }));
+    REQUIRE(plan.proportions[0] == Approx(1.0).margin(1e-5));
+    REQUIRE(plan.makespan == Approx(1.0).margin(1e-9));
+  }
+
+  SECTION("the fixed cost shifts work to the device that starts earlier")
+  {
+    auto plan = ecl::planDevices({ profile(0, 0.2, 1.0), profile(1, 0.0, 1.0) }, 1000);
+    REQUIRE(plan.devices == vector<int>({ 0, 1 }));
+    REQUIRE(plan.makespan == Approx(0.6).margin(1e-9));
+    REQUIRE(plan.proportions[0] == Approx(0.4).margin(1e-5));
+    REQUIRE(plan.proportions[1] == Approx(0.6).margin(1e-5));
+  }
+}
@@ -0,0 +1,47 @@
+#include "./tests.hpp"
+
+#include <thread>
+
+#include "EventRing.hpp"
+
+using namespace std;
+
+TEST_CASE("EventRing", "[EventRing]")
+{
+  SECTION("keeps the events in order until the capacity")
+  {
+    ecl::EventRing<int> ring(4);
+    ring.push(1);
+    ring.push(2);
+    ring.push(3);
+    REQUIRE(ring.size() == 3);
+    REQUIRE(ring.dropped() == 0);
+    REQUIRE(ring.toVector() == vector<int>({ 1, 2, 3 }));
+  }
+
+  SECTION("overwrites the oldest events when full")
+  {
+    ecl::EventRing<int> ring(4);
+    for (int i = 1; i <= 6; ++i) {
+      ring.push(i);
+    }
+    REQUIRE(ring.size() == 4);
+    REQUIRE(ring.dropped() == 2);
+    REQUIRE(ring[0] == 3);
+    REQUIRE(ring.toVector() == vector<int>({ 3, 4, 5, 6 }));
+  }
+
+  SECTION("events of a writer thread are visible after it is joined (moved ring)")
+  {
+    ecl::EventRing<size_t> ring(1 << 17);
+    thread writer([&ring] {
+      for (size_t i = 0; i < 100000; ++i) {
+        ring.push(i);
+      }
+    });
+    writer.join();
+    auto moved = move(ring);
+    REQUIRE(moved.size() == 100000);
+    REQUIRE(moved[99999] == 99999);
+  }
+}
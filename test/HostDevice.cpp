@@ -0,0 +1,211 @@
+#include "./tests.hpp"
+
+#include "EngineCL.hpp"
+
+using namespace std;
+
+TEST_CASE("HostDevice", "[HostDevice]")
+{
+  size_t size = 4096;
+  auto in = make_shared<vector<int>>(size);
+  auto out = make_shared<vector<int>>(size, 0);
+  for (size_t i = 0; i < size; ++i) {
+    (*in)[i] = i;
+  }
+  auto& x = *in;
+  auto& y = *out;
+  auto kernel = [&](size_t offset, size_t size) {
+    for (auto i = offset; i < offset + size; ++i) {
+      y[i] = 2 * x[i];
+    }
+  };
+  auto computed = [&] {
+    for (size_t i = 0; i < size; ++i) {
+      if (y[i] != 2 * x[i]) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  SECTION("the pool covers the range and rethrows the errors of its threads")
+  {
+    ecl::ThreadPool pool(3);
+    REQUIRE(pool.size() == 3);
+    vector<int> hits(1000, 0);
+    pool.parallelFor(0, 1000, 64, [&](size_t offset, size_t size) {
+      REQUIRE(offset % 64 == 0);
+      for (auto i = offset; i < offset + size; ++i) {
+        hits[i]++;
+      }
+    });
+    REQUIRE(count(hits.begin(), hits.end(), 1) == 1000);
+    auto failing = [](size_t offset, size_t) {
+      if (offset > 0) {
+        throw runtime_error("part failed");
+      }
+    };
+    REQUIRE_THROWS_WITH(pool.parallelFor(0, 1000, 64, failing), Catch::Contains("part failed"));
+    pool.parallelFor(0, 0, 64, failing); // nothing to compute
+  }
+
+  SECTION("host devices compute the chunks of the schedulers")
+  {
+    ecl::DynamicScheduler dynamic;
+    ecl::StaticScheduler fixed;
+    vector<ecl::Scheduler*> schedulers = { &dynamic, &fixed };
+    for (auto sched : schedulers) {
+      fill(y.begin(), y.end(), 0);
+      vector<ecl::Device> devices;
+      devices.emplace_back(ecl::HostDevice(2));
+      devices.emplace_back(ecl::HostDevice(1));
+      ecl::Runtime runtime(move(devices), size, 64);
+      runtime.setScheduler(sched);
+      dynamic.setChunks(16);
+      runtime.setInBuffer(in);
+      runtime.setOutBuffer(out);
+      runtime.setHostKernel(kernel);
+      runtime.run();
+      REQUIRE(computed());
+      REQUIRE(runtime.getCompletedRanges() ==
+              vector<tuple<size_t, size_t>>({ make_tuple(size_t(0), size) }));
+      auto stats = runtime.stats();
+      REQUIRE(stats.devices[0].host);
+      REQUIRE(stats.devices[0].worksSize + stats.devices[1].worksSize == size);
+      REQUIRE(stats.devices[0].writeBytes == 0);
+      REQUIRE(stats.toJson().find("\"host\":true") != string::npos);
+      REQUIRE_THROWS_WITH(runtime.setHostKernel(kernel), Catch::Contains("before prepare"));
+    }
+  }
+
+  SECTION("a host kernel raising the exit flag stops the run")
+  {
+    size_t target = 1000;
+    ecl::DynamicScheduler sched;
+    vector<ecl::Device> devices;
+    devices.emplace_back(ecl::HostDevice(1));
+    devices.emplace_back(ecl::HostDevice(2));
+    ecl::Runtime runtime(move(devices), size, 64);
+    runtime.setScheduler(&sched);
+    sched.setChunks(64);
+    runtime.setOutBuffer(out);
+    runtime.setKernelArgExitFlag(0);
+    runtime.setHostKernel([&](size_t offset, size_t size) {
+      if (offset <= target && target < offset + size) {
+        ecl::HostDevice::raiseExit();
+      }
+    });
+    REQUIRE(runtime.run() == ecl::RunStatus::EarlyExit);
+    auto range = runtime.getExitRange();
+    REQUIRE(std::get<0>(range) <= target);
+    REQUIRE(target < std::get<0>(range) + std::get<1>(range));
+    auto stats = runtime.stats();
+    REQUIRE(stats.devices[0].worksSize + stats.devices[1].worksSize < size);
+    REQUIRE_THROWS_WITH(ecl::HostDevice::raiseExit(), Catch::Contains("from a host kernel"));
+  }
+
+  SECTION("mixed devices require both kernels")
+  {
+    ecl::DynamicScheduler sched;
+    vector<ecl::Device> devices;
+    devices.emplace_back(ecl::Device(99, 0));
+    devices.emplace_back(ecl::HostDevice());
+    ecl::Runtime runtime(move(devices), size, 64);
+    runtime.setScheduler(&sched);
+    runtime.setInBuffer(in);
+    runtime.setOutBuffer(out);
+    runtime.setHostKernel(kernel);
+    REQUIRE_THROWS_WITH(runtime.run(), Catch::Contains("setKernel should be called"));
+  }
+
+  SECTION("a host device recovers the work of a failed device (unavailable platforms)")
+  {
+    ecl::DynamicScheduler sched;
+    vector<ecl::Device> devices;
+    devices.emplace_back(ecl::Device(99, 0));
+    devices.emplace_back(ecl::HostDevice());
+    ecl::Runtime runtime(move(devices), size, 64);
+    runtime.setScheduler(&sched);
+    sched.setChunks(32);
+    runtime.setInBuffer(in);
+    runtime.setOutBuffer(out);
+    runtime.setKernel("__kernel void k(){}", "k");
+    runtime.setHostKernel(kernel);
+    runtime.run();
+    REQUIRE(computed());
+    auto stats = runtime.stats();
+    REQUIRE(stats.devices[0].quarantined);
+    REQUIRE(stats.devices[1].worksSize == size);
+  }
+
+  SECTION("the kernels required depend on the devices")
+  {
+    ecl::DynamicScheduler sched;
+    vector<ecl::Device> devices;
+    devices.emplace_back(ecl::HostDevice());
+    ecl::Runtime runtime(move(devices), size, 64);
+    runtime.setScheduler(&sched);
+    runtime.setOutBuffer(out);
+    runtime.setKernel("__kernel void k(){}", "k");
+    REQUIRE_THROWS_WITH(runtime.run(), Catch::Contains("setHostKernel should be called"));
+  }
+
+  SECTION("a reactor drives host devices (unavailable platforms)")
+  {
+    ecl::DynamicScheduler sched;
+    vector<ecl::Device> devices;
+    devices.emplace_back(ecl::Device(99, 0));
+    devices.emplace_back(ecl::HostDevice(2));
+    devices.emplace_back(ecl::HostDevice(1));
+    ecl::Runtime runtime(move(devices), size, 64);
+    runtime.setScheduler(&sched);
+    sched.setChunks(32);
+    runtime.setInBuffer(in);
+    runtime.setOutBuffer(out);
+    runtime.setKernel("__kernel void k(){}", "k");
+    runtime.setHostKernel(kernel);
+    runtime.setReactor(true);
+    runtime.run();
+    REQUIRE(computed());
+    auto stats = runtime.stats();
+    REQUIRE(stats.devices[0].quarantined);
+    REQUIRE(stats.devices[1].worksSize + stats.devices[2].worksSize == size);
+    for (size_t i = 1; i < 3; ++i) { // stages in the reactor, chunks in their launchers
+      auto& device = stats.devices[i];
+      REQUIRE(device.chunks.size() == device.works);
+      REQUIRE(device.eventsDropped == 0);
+      size_t items = 0;
+      for (auto& chunk : device.chunks) {
+        items += chunk.size;
+      }
+      REQUIRE(items == device.worksSize);
+    }
+  }
+
+  SECTION("calibrating an accumulating kernel leaves the arrays as registered")
+  {
+    fill(y.begin(), y.end(), 1);
+    vector<ecl::Device> devices;
+    devices.emplace_back(ecl::HostDevice(2));
+    devices.emplace_back(ecl::HostDevice(1));
+    ecl::StaticScheduler sched;
+    ecl::Runtime runtime(move(devices), size, 64);
+    runtime.setScheduler(&sched);
+    runtime.setInBuffer(in);
+    runtime.setOutBuffer(out);
+    runtime.setHostKernel([&](size_t offset, size_t size) {
+      for (auto i = offset; i < offset + size; ++i) {
+        x[i] += 1;
+        y[i] += x[i];
+      }
+    });
+    auto calibration = runtime.calibrate(size / 4);
+    REQUIRE(calibration.profiles.size() == 2);
+    REQUIRE(count(y.begin(), y.end(), 1) == static_cast<long>(size));
+    auto restored = true;
+    for (size_t i = 0; i < size; ++i) {
+      restored = restored && x[i] == static_cast<int>(i);
+    }
+    REQUIRE(restored);
+  }
+}
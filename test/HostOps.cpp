@@ -0,0 +1,72 @@
+#include "./tests.hpp"
+
+#include <cmath>
+#include <limits>
+
+#include "EngineCL.hpp"
+
+using namespace std;
+
+TEST_CASE("HostOps", "[HostOps]")
+{
+  // above ECL_HOST_PARALLEL_BYTES, so the OpenMP path (if built) runs
+  size_t size = 2 * ECL_HOST_PARALLEL_BYTES / sizeof(float) + 3;
+
+  SECTION("fill and copy every item")
+  {
+    vector<float> a(size, 0.0f);
+    ecl::parallelFill(a, 2.5f);
+    REQUIRE(count(a.begin(), a.end(), 2.5f) == static_cast<long>(size));
+    vector<float> b(size, 0.0f);
+    ecl::parallelCopy(b, a, 2);
+    REQUIRE(b == a);
+    vector<int> small(7);
+    ecl::parallelFill(small, -1);
+    REQUIRE(small == vector<int>(7, -1));
+    REQUIRE_THROWS_WITH(ecl::parallelCopy(small, vector<int>(3)), Catch::Contains("sizes"));
+  }
+
+  SECTION("comparisons find the first mismatch within a tolerance")
+  {
+    vector<float> expected(size, 1000.0f);
+    vector<float> actual = expected;
+    REQUIRE(ecl::parallelCompare(actual, expected).ok());
+
+    actual[size - 1] = 1000.01f;
+    actual[size / 2] = 1000.01f;
+    auto exact = ecl::parallelCompare(actual, expected);
+    REQUIRE(exact.mismatches == 2);
+    REQUIRE(exact.first == size / 2);
+    REQUIRE(exact.maxError == Approx(0.01).epsilon(0.01));
+    REQUIRE(ecl::parallelCompare(actual, expected, 1e-4).ok()); // relative
+
+    expected[0] = 0.0f;
+    actual[0] = 1e-6f;
+    REQUIRE(ecl::parallelCompare(actual, expected, 1e-4).ok()); // absolute near zero
+    actual[0] = numeric_limits<float>::quiet_NaN();
+    auto nan = ecl::parallelCompare(actual, expected, 1e-4);
+    REQUIRE(nan.mismatches == 1);
+    REQUIRE(nan.first == 0);
+    REQUIRE(std::isinf(nan.maxError));
+
+    vector<int> ints = { 1, 2, 3 };
+    auto first = ecl::parallelCompare(ints, vector<int>({ 1, 2, 4 }));
+    REQUIRE(first.first == 2);
+    REQUIRE(first.mismatches == 1);
+  }
+
+  SECTION("comparisons compute the expected items")
+  {
+    vector<int> actual(size);
+    for (size_t i = 0; i < size; ++i) {
+      actual[i] = 3 * i;
+    }
+    auto expected = [](size_t i) { return static_cast<int>(3 * i); };
+    REQUIRE(ecl::parallelCompare(actual, expected).ok());
+    actual[size - 2] = 0;
+    actual[size / 3] = 0;
+    auto wrong = ecl::parallelCompare(actual, expected);
+    REQUIRE(wrong.mismatches == 2);
+    REQUIRE(wrong.first == size / 3);
+  }
+}
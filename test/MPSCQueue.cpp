@@ -0,0 +1,69 @@
+#include "./tests.hpp"
+
+#include <thread>
+
+#include "MPSCQueue.hpp"
+
+using namespace std;
+
+TEST_CASE("MPSCQueue", "[MPSCQueue]")
+{
+  SECTION("keeps the order and fails when full or empty")
+  {
+    ecl::MPSCQueue<int> queue(3);
+    REQUIRE(queue.capacity() == 4);
+    int value;
+    REQUIRE_FALSE(queue.pop(value));
+    for (int i = 1; i <= 4; ++i) {
+      REQUIRE(queue.push(i));
+    }
+    REQUIRE_FALSE(queue.push(5)); // nothing is overwritten
+    REQUIRE(queue.size() == 4);
+    REQUIRE(queue.pop(value));
+    REQUIRE(value == 1);
+    REQUIRE(queue.push(5));
+    for (int i = 2; i <= 5; ++i) {
+      REQUIRE(queue.pop(value));
+      REQUIRE(value == i);
+    }
+    REQUIRE_FALSE(queue.pop(value));
+    REQUIRE(queue.pushed() == 5);
+    REQUIRE(queue.popped() == 5);
+  }
+
+  SECTION("concurrent producers lose and duplicate nothing")
+  {
+    const int producers = 4;
+    const int values = 50000;
+    ecl::MPSCQueue<int> queue(8); // small, so producers find it full
+    vector<thread> threads;
+    for (int p = 0; p < producers; ++p) {
+      threads.emplace_back([&queue, p] {
+        for (int i = 0; i < values; ++i) {
+          while (!queue.push(p * values + i)) {
+            this_thread::yield();
+          }
+        }
+      });
+    }
+    vector<int> last(producers, -1);
+    auto received = 0;
+    auto ordered = true;
+    while (received < producers * values) {
+      int value;
+      if (queue.pop(value)) {
+        auto p = value / values;
+        ordered = ordered && value % values == last[p] + 1; // FIFO per producer
+        last[p] = value % values;
+        received++;
+      } else {
+        this_thread::yield();
+      }
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    REQUIRE(ordered);
+    REQUIRE(queue.size() == 0);
+  }
+}
@@ -0,0 +1,69 @@
+#include "./tests.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "EngineCL.hpp"
+
+using namespace std;
+
+TEST_CASE("Metrics", "[Metrics]")
+{
+  SECTION("the counters of finished runs are kept in the file (unavailable platforms)")
+  {
+    string path = "/tmp/enginecl-test-metrics.prom";
+    std::remove(path.c_str());
+    {
+      ecl::MetricsExporter exporter(path, std::chrono::milliseconds(10));
+      auto out = make_shared<vector<int>>(1024, 0);
+      ecl::DynamicScheduler sched;
+      vector<ecl::Device> devices;
+      devices.emplace_back(ecl::Device(99, 0));
+
+      ecl::Runtime runtime(move(devices), 1024, 128);
+      runtime.setScheduler(&sched);
+      runtime.setMetricsExporter(&exporter);
+      runtime.setOutBuffer(out);
+      runtime.setKernel("__kernel void k(){}", "k");
+      REQUIRE_THROWS(runtime.run());
+    }
+    ifstream file(path);
+    stringstream text;
+    text << file.rdbuf();
+    REQUIRE_THAT(text.str(), Catch::Contains("# TYPE enginecl_runs_total counter\n"));
+    REQUIRE_THAT(text.str(), Catch::Contains("enginecl_runs_total 1\n"));
+    REQUIRE_THAT(text.str(), Catch::Contains("enginecl_running 0\n"));
+    REQUIRE_THAT(text.str(), Catch::Contains("enginecl_chunks_total{device=\"0\"} 0\n"));
+    std::remove(path.c_str());
+  }
+
+  SECTION("the socket answers every connection with the metrics")
+  {
+    string path = "/tmp/enginecl-test-metrics.sock";
+    ecl::MetricsExporter exporter("unix:" + path, std::chrono::milliseconds(10));
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    REQUIRE(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    string request = "GET /metrics HTTP/1.0\r\n\r\n";
+    REQUIRE(send(fd, request.data(), request.size(), 0) == (ssize_t)request.size());
+    string response;
+    char buffer[512];
+    ssize_t n;
+    while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+      response.append(buffer, n);
+    }
+    close(fd);
+    REQUIRE_THAT(response, Catch::StartsWith("HTTP/1.0 200 OK\r\n"));
+    REQUIRE_THAT(response, Catch::Contains("enginecl_runs_total 0\n"));
+  }
+}
@@ -0,0 +1,87 @@
+#include "./tests.hpp"
+
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "EngineCL.hpp"
+
+using namespace std;
+
+// node of the page (touched) holding `ptr`
+static int
+pageNode(void* ptr)
+{
+  int node = -1;
+  syscall(SYS_get_mempolicy, &node, nullptr, 0, ptr, MPOL_F_NODE | MPOL_F_ADDR);
+  return node;
+}
+
+TEST_CASE("Numa", "[Numa]")
+{
+  auto nodes = ecl::numaNodes();
+  REQUIRE(!nodes.empty());
+  auto node = nodes.back();
+
+  SECTION("nodes of the CPUs")
+  {
+    auto cpus = ecl::availableCpus();
+    auto cpuNode = ecl::cpuNode(cpus[0]);
+    REQUIRE(find(nodes.begin(), nodes.end(), cpuNode) != nodes.end());
+    REQUIRE(ecl::cpusNode({ cpus[0] }) == cpuNode);
+    REQUIRE(ecl::cpusNode({}) == -1);
+  }
+
+  SECTION("vectors are placed before their first touch")
+  {
+    size_t size = 1 << 20;
+    auto bound = ecl::makeNumaVector<float>(size, ecl::NumaPlacement::bind(node), 1.0f);
+    REQUIRE(bound->size() == size);
+    REQUIRE(bound->at(size - 1) == 1.0f);
+    REQUIRE(pageNode(bound->data() + size / 2) == node);
+
+    auto interleaved = ecl::makeNumaVector<int>(size, ecl::NumaPlacement::interleave());
+    REQUIRE(interleaved->at(size / 2) == 0);
+
+    auto empty = ecl::makeNumaVector<int>(0, ecl::NumaPlacement::bind(node));
+    REQUIRE(empty->empty());
+  }
+
+  SECTION("invalid placements are rejected")
+  {
+    vector<char> data(1 << 16);
+    ecl::NumaPlacement many{ ecl::NumaPlacement::Policy::Bind, { 0, 1 } };
+    REQUIRE_THROWS_WITH(ecl::placeMemory(data.data(), data.size(), many),
+                        Catch::Contains("single node"));
+    auto unknown = ecl::NumaPlacement::bind(1000);
+    REQUIRE_THROWS_WITH(ecl::placeMemory(data.data(), data.size(), unknown),
+                        Catch::Contains("cannot place"));
+  }
+
+  SECTION("the runtime places the registered buffers and stages them")
+  {
+    auto in = make_shared<vector<int>>(1 << 16, 1);
+    auto out = make_shared<vector<int>>(1 << 16, 0);
+    ecl::DynamicScheduler sched;
+    vector<ecl::Device> devices;
+    devices.emplace_back(ecl::Device(99, 0));
+    devices.emplace_back(ecl::Device(99, 1));
+    ecl::Runtime runtime(move(devices), in->size(), 128);
+    runtime.setScheduler(&sched);
+
+    auto cpu = ecl::availableCpus().front();
+    ecl::AffinityPolicy policy;
+    policy.setDevice(1, { cpu });
+    runtime.setAffinity(policy);
+    REQUIRE(runtime.getDeviceNode(0) == -1);
+    REQUIRE(runtime.getDeviceNode(1) == ecl::cpuNode(cpu));
+
+    runtime.setInBuffer(in, ecl::NumaPlacement::bind(runtime.getDeviceNode(1)));
+    runtime.setOutBuffer(out, ecl::NumaPlacement::interleave());
+    REQUIRE(pageNode(in->data() + in->size() / 2) == runtime.getDeviceNode(1));
+    runtime.setNodeLocalStaging(true);
+    runtime.setKernel("__kernel void k(){}", "k");
+    REQUIRE_THROWS_WITH(runtime.run(), Catch::Contains("every device failed"));
+    REQUIRE_THROWS_WITH(runtime.setNodeLocalStaging(false), Catch::Contains("before prepare"));
+  }
+}
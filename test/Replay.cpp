@@ -0,0 +1,175 @@
+#include "./tests.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <sstream>
+
+#include "EngineCL.hpp"
+
+using namespace std;
+
+TEST_CASE("Replay", "[Replay]")
+{
+  ecl::DecisionLog log;
+  log.size = 1024;
+  log.dispatches = { { 1000, 0, 0, 256 },
+                     { 900, 1, 256, 512 },
+                     { 5000000000, 0, 768, 256 } };
+
+  SECTION("decision logs are written and read back")
+  {
+    stringstream ss;
+    log.write(ss);
+    auto bytes = ss.str().size();
+    REQUIRE(bytes < 40);
+    auto read = ecl::DecisionLog::read(ss);
+    REQUIRE(read.size == 1024);
+    REQUIRE(read.dispatches.size() == 3);
+    REQUIRE(read.dispatches[1].ts_ns == 900);
+    REQUIRE(read.dispatches[1].device == 1);
+    REQUIRE(read.dispatches[1].offset == 256);
+    REQUIRE(read.dispatches[2].ts_ns == 5000000000);
+    REQUIRE(read.dispatches[2].size == 256);
+
+    stringstream truncated(ss.str().substr(0, bytes - 1));
+    REQUIRE_THROWS_WITH(ecl::DecisionLog::read(truncated), "truncated decision log");
+    stringstream other("{\"traceEvents\":[]}");
+    REQUIRE_THROWS_WITH(ecl::DecisionLog::read(other), "not a decision log");
+    auto huge = ss.str().substr(0, 9);   // magic, version and size
+    huge += string(9, '\xff') + '\x00'; // 2^63 - 1 records
+    stringstream corrupted(huge + ss.str().substr(10));
+    REQUIRE_THROWS_WITH(ecl::DecisionLog::read(corrupted), "corrupted decision log");
+  }
+
+  SECTION("logs not covering the problem are rejected")
+  {
+    log.dispatches.pop_back();
+    REQUIRE_THROWS_WITH(ecl::ReplayScheduler(log), Catch::Contains("does not cover"));
+  }
+
+  SECTION("logs dispatching a range twice are rejected")
+  {
+    auto duplicated = log;
+    duplicated.dispatches.push_back({ 6000, 1, 0, 256 });
+    REQUIRE_THROWS_WITH(ecl::ReplayScheduler(duplicated), Catch::Contains("at 0 more than once"));
+    log.dispatches[2].offset = 512;
+    REQUIRE_THROWS_WITH(ecl::ReplayScheduler(log), Catch::Contains("at 512 more than once"));
+  }
+
+  SECTION("the decisions of long runs are recorded while running, not saved after")
+  {
+    string path = "/tmp/enginecl-test-recorded.bin";
+    size_t size = 128 * (ECL_EVENTS_CAPACITY + 1);
+    auto out = make_shared<vector<int>>(size, 0);
+    ecl::DynamicScheduler sched;
+    vector<ecl::Device> devices;
+    devices.emplace_back(ecl::HostDevice(1));
+    ecl::Runtime runtime(move(devices), size, 128);
+    runtime.setScheduler(&sched);
+    sched.setChunks(ECL_EVENTS_CAPACITY + 1);
+    runtime.setOutBuffer(out);
+    runtime.setHostKernel([](size_t, size_t) {});
+    runtime.recordDecisions(path);
+    runtime.run();
+    REQUIRE_THROWS_WITH(runtime.saveDecisions("/tmp/enginecl-test-dropped.bin"),
+                        Catch::Contains("oldest 1 dispatches were dropped"));
+    auto recorded = ecl::DecisionLog::load(path);
+    REQUIRE(recorded.size == size);
+    REQUIRE(recorded.dispatches.size() == ECL_EVENTS_CAPACITY + 1);
+    REQUIRE_NOTHROW(ecl::ReplayScheduler(recorded));
+    std::remove(path.c_str());
+  }
+
+  SECTION("the decisions of a run with recovered chunks are replayed")
+  {
+    size_t size = 4096;
+    string path = "/tmp/enginecl-test-decisions.bin";
+    auto out = make_shared<vector<int>>(size, 0);
+    auto& y = *out;
+    std::atomic<int> calls(0);
+    auto failing = true;
+    auto kernel = [&](size_t offset, size_t size) {
+      if (failing && calls++ == 2) {
+        throw runtime_error("chunk failed");
+      }
+      for (auto i = offset; i < offset + size; ++i) {
+        y[i] = i;
+      }
+    };
+    {
+      ecl::DynamicScheduler sched;
+      vector<ecl::Device> devices;
+      devices.emplace_back(ecl::HostDevice(1));
+      devices.emplace_back(ecl::HostDevice(1));
+      ecl::Runtime runtime(move(devices), size, 128);
+      runtime.setScheduler(&sched);
+      sched.setChunks(16);
+      runtime.setOutBuffer(out);
+      runtime.setHostKernel(kernel);
+      runtime.recordDecisions(path + ".rec");
+      runtime.run();
+      REQUIRE(runtime.stats().scheduler.recoveries.size() == 1);
+      runtime.saveDecisions(path);
+    }
+    auto decisions = ecl::DecisionLog::load(path);
+    REQUIRE(decisions.dispatches.size() == 16);
+    auto recorded = ecl::DecisionLog::load(path + ".rec"); // without the lost dispatch too
+    REQUIRE(recorded.dispatches.size() == 16);
+    for (size_t i = 0; i < 16; ++i) {
+      REQUIRE(recorded.dispatches[i].device == decisions.dispatches[i].device);
+      REQUIRE(recorded.dispatches[i].offset == decisions.dispatches[i].offset);
+    }
+    std::remove((path + ".rec").c_str());
+
+    failing = false;
+    fill(y.begin(), y.end(), 0);
+    ecl::ReplayScheduler sched(decisions);
+    vector<ecl::Device> devices;
+    devices.emplace_back(ecl::HostDevice(1));
+    devices.emplace_back(ecl::HostDevice(1));
+    ecl::Runtime runtime(move(devices), size, 128);
+    runtime.setScheduler(&sched);
+    runtime.setOutBuffer(out);
+    runtime.setHostKernel(kernel);
+    runtime.run();
+    REQUIRE(runtime.getCompletedRanges() ==
+            vector<tuple<size_t, size_t>>({ make_tuple(size_t(0), size) }));
+    auto wrong = 0;
+    for (size_t i = 0; i < size; ++i) {
+      wrong += y[i] != static_cast<int>(i);
+    }
+    REQUIRE(wrong == 0);
+    std::remove(path.c_str());
+  }
+
+  SECTION("the replay checks the problem size and the devices")
+  {
+    ecl::ReplayScheduler sched(log);
+    vector<ecl::Device> devices;
+    devices.emplace_back(ecl::Device(99, 0));
+    ecl::Runtime runtime(move(devices), 2048, 128);
+    REQUIRE_THROWS_WITH(runtime.setScheduler(&sched), Catch::Contains("replayed with size 2048"));
+
+    vector<ecl::Device> one;
+    one.emplace_back(ecl::Device(99, 0));
+    ecl::Runtime small(move(one), 1024, 128);
+    REQUIRE_THROWS_WITH(small.setScheduler(&sched), Catch::Contains("uses device 1 of 1"));
+  }
+
+  SECTION("the chunks of failed devices are released (unavailable platforms)")
+  {
+    auto out = make_shared<vector<int>>(1024, 0);
+    ecl::ReplayScheduler sched(log);
+    vector<ecl::Device> devices;
+    devices.emplace_back(ecl::Device(99, 0));
+    devices.emplace_back(ecl::Device(99, 1));
+
+    ecl::Runtime runtime(move(devices), 1024, 128);
+    runtime.setScheduler(&sched);
+    runtime.setOutBuffer(out);
+    runtime.setKernel("__kernel void k(){}", "k");
+    REQUIRE_THROWS_WITH(runtime.run(), Catch::Contains("every device failed"));
+    REQUIRE(runtime.stats().scheduler.name == "replay");
+    REQUIRE(runtime.getCompletedRanges().empty());
+  }
+}
@@ -0,0 +1,268 @@
+#include "./tests.hpp"
+
+#include "EngineCL.hpp"
+
+using namespace std;
+
+TEST_CASE("Runtime", "[Runtime]")
+{
+  SECTION("run reports the failure when every device fails (unavailable platforms)")
+  {
+    auto in = make_shared<vector<int>>(1024, 1);
+    auto out = make_shared<vector<int>>(1024, 0);
+    ecl::DynamicScheduler sched;
+    vector<ecl::Device> devices;
+    devices.emplace_back(ecl::Device(99, 0));
+    devices.emplace_back(ecl::Device(99, 1));
+
+    ecl::Runtime runtime(move(devices), 1024, 128);
+    runtime.setScheduler(&sched);
+    sched.setChunks(4);
+    runtime.setInBuffer(in);
+    runtime.setOutBuffer(out);
+    runtime.setKernel("__kernel void k(){}", "k");
+    REQUIRE_THROWS_WITH(runtime.run(), Catch::Contains("every device failed"));
+
+    auto stats = runtime.stats();
+    REQUIRE(stats.devices.size() == 2);
+    REQUIRE(stats.devices[1].quarantined);
+    REQUIRE(stats.devices[1].works == 0);
+    REQUIRE(stats.scheduler.name == "dynamic");
+    REQUIRE(stats.scheduler.chunks == 0);
+  }
+
+  SECTION("a reactor drives every device from one thread (unavailable platforms)")
+  {
+    auto out = make_shared<vector<int>>(1024, 0);
+    ecl::DynamicScheduler sched;
+    vector<ecl::Device> devices;
+    for (uint i = 0; i < 4; ++i) {
+      devices.emplace_back(ecl::Device(99, i));
+    }
+    auto cpu = ecl::availableCpus().front();
+    ecl::AffinityPolicy policy;
+    policy.setDevice(2, { cpu });
+
+    ecl::Runtime runtime(move(devices), 1024, 128);
+    runtime.setScheduler(&sched);
+    runtime.setOutBuffer(out);
+    runtime.setKernel("__kernel void k(){}", "k");
+    runtime.setAffinity(policy);
+    runtime.setReactor(true);
+    REQUIRE_THROWS_WITH(runtime.run(), Catch::Contains("every device failed"));
+    REQUIRE_THROWS_WITH(runtime.setReactor(false), Catch::Contains("before prepare"));
+
+    auto stats = runtime.stats();
+    REQUIRE(stats.devices.size() == 4);
+    for (auto& device : stats.devices) {
+      REQUIRE(device.quarantined);
+      REQUIRE(device.cpus == vector<int>({ cpu })); // the thread of the reactor
+    }
+  }
+
+  SECTION("the devices overlap in reactor mode")
+  {
+    size_t size = 1 << 14;
+    auto out = make_shared<vector<int>>(size, 0);
+    ecl::DeviceModel model{ "slow", 1e5, 10e-6, 0, 0.0, 0.0, 0.0, 0.0 }; // 82 ms per half
+    ecl::StaticScheduler sched;
+    vector<ecl::Device> devices;
+    devices.emplace_back(ecl::SimulatedDevice(model));
+    devices.emplace_back(ecl::SimulatedDevice(model));
+    ecl::Runtime runtime(move(devices), size, 128);
+    runtime.setScheduler(&sched);
+    runtime.setOutBuffer(out);
+    runtime.setReactor(true);
+    runtime.run();
+
+    auto stats = runtime.stats();
+    REQUIRE(stats.devices[0].chunks.size() == 1);
+    REQUIRE(stats.devices[1].chunks.size() == 1);
+    auto& first = stats.devices[0].chunks[0];
+    auto& second = stats.devices[1].chunks[0];
+    REQUIRE(first.ts_ns < second.ts_ns + second.duration_ns);
+    REQUIRE(second.ts_ns < first.ts_ns + first.duration_ns);
+  }
+
+  SECTION("a reactor device woken for many chunks at once")
+  {
+    size_t size = 128 * 64;
+    auto out = make_shared<vector<int>>(size, 0);
+    auto& y = *out;
+    ecl::DecisionLog log;
+    log.size = size;
+    for (size_t i = 0; i < 64; ++i) { // the replay wakes a device once per chunk queued
+      log.dispatches.push_back({ 0, static_cast<int>(i % 2), i * 128, 128 });
+    }
+    ecl::ReplayScheduler sched(log);
+    vector<ecl::Device> devices;
+    devices.emplace_back(ecl::HostDevice(1));
+    devices.emplace_back(ecl::HostDevice(1));
+    ecl::Runtime runtime(move(devices), size, 128);
+    runtime.setScheduler(&sched);
+    runtime.setOutBuffer(out);
+    runtime.setHostKernel([&y](size_t offset, size_t size) {
+      for (auto i = offset; i < offset + size; ++i) {
+        y[i] = i;
+      }
+    });
+    runtime.setReactor(true);
+    runtime.run();
+    REQUIRE(runtime.getCompletedRanges() ==
+            vector<tuple<size_t, size_t>>({ make_tuple(size_t(0), size) }));
+    REQUIRE(runtime.stats().devices[1].works == 32);
+  }
+
+  SECTION("static packages of failed devices are released (unavailable platforms)")
+  {
+    auto out = make_shared<vector<int>>(1024, 0);
+    ecl::StaticScheduler sched;
+    vector<ecl::Device> devices;
+    devices.emplace_back(ecl::Device(99, 0));
+    devices.emplace_back(ecl::Device(99, 1));
+
+    ecl::Runtime runtime(move(devices), 1024, 128);
+    runtime.setScheduler(&sched);
+    sched.setRawProportions({ 0.5 });
+    runtime.setOutBuffer(out);
+    runtime.setKernel("__kernel void k(){}", "k");
+    REQUIRE_THROWS_WITH(runtime.run(), Catch::Contains("every device failed"));
+  }
+
+  SECTION("the chunks of failed devices are computed by the survivors")
+  {
+    size_t size = 4096;
+    auto out = make_shared<vector<int>>(size, 0);
+    auto& y = *out;
+    std::atomic<int> calls(0);
+    auto kernel = [&](size_t offset, size_t size) {
+      if (calls++ == 2) {
+        throw runtime_error("chunk failed");
+      }
+      for (auto i = offset; i < offset + size; ++i) {
+        y[i] = i;
+      }
+    };
+    ecl::DynamicScheduler dynamic;
+    ecl::StaticScheduler fixed;
+    vector<ecl::Scheduler*> schedulers = { &dynamic, &fixed };
+    for (auto sched : schedulers) {
+      calls = 0;
+      fill(y.begin(), y.end(), 0);
+      vector<ecl::Device> devices;
+      devices.emplace_back(ecl::Device(99, 0)); // fails before its first chunk
+      devices.emplace_back(ecl::HostDevice(1));
+      devices.emplace_back(ecl::HostDevice(1));
+      ecl::Runtime runtime(move(devices), size, 128);
+      runtime.setScheduler(sched);
+      if (sched == &dynamic) {
+        dynamic.setChunks(16);
+      }
+      runtime.setOutBuffer(out);
+      runtime.setKernel("__kernel void k(){}", "k");
+      runtime.setHostKernel(kernel);
+      runtime.run();
+
+      auto stats = runtime.stats();
+      REQUIRE(stats.devices[0].quarantined);
+      REQUIRE(stats.devices[1].quarantined != stats.devices[2].quarantined); // the third chunk
+      auto failed = stats.devices[1].quarantined ? 1 : 2;
+      REQUIRE(stats.devices[failed].failure.find("chunk failed") != string::npos);
+      REQUIRE(stats.devices[3 - failed].works > 0);
+      REQUIRE(runtime.getCompletedRanges() ==
+              vector<tuple<size_t, size_t>>({ make_tuple(size_t(0), size) }));
+      auto wrong = 0;
+      for (size_t i = 0; i < size; ++i) {
+        wrong += y[i] != static_cast<int>(i);
+      }
+      REQUIRE(wrong == 0);
+    }
+  }
+
+  SECTION("a run cancelled before starting releases the devices (unavailable platforms)")
+  {
+    auto out = make_shared<vector<int>>(1024, 0);
+    ecl::StaticScheduler sched;
+    vector<ecl::Device> devices;
+    devices.emplace_back(ecl::Device(99, 0));
+
+    ecl::Runtime runtime(move(devices), 1024, 128);
+    runtime.setScheduler(&sched);
+    runtime.setOutBuffer(out);
+    runtime.setKernel("__kernel void k(){}", "k");
+    runtime.cancel();
+    REQUIRE(runtime.getStatus() == ecl::RunStatus::Cancelled);
+    REQUIRE_THROWS_WITH(runtime.run(), Catch::Contains("every device failed"));
+    REQUIRE(runtime.getCompletedRanges().empty());
+    REQUIRE_THROWS_WITH(runtime.getExitRange(), Catch::Contains("no chunk raised"));
+  }
+
+  SECTION("a cancel stops the devices running")
+  {
+    size_t size = 1 << 16;
+    auto out = make_shared<vector<int>>(size, 0);
+    ecl::DeviceModel model{ "slow", 1e5, 10e-6, 0, 0.0, 0.0, 0.0, 0.0 }; // 0.33 s in all
+    ecl::DynamicScheduler sched;
+    vector<ecl::Device> devices;
+    devices.emplace_back(ecl::SimulatedDevice(model));
+    devices.emplace_back(ecl::SimulatedDevice(model));
+    ecl::Runtime runtime(move(devices), size, 128);
+    runtime.setScheduler(&sched);
+    sched.setChunks(64);
+    runtime.setOutBuffer(out);
+
+    thread canceller([&] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(30));
+      runtime.cancel();
+    });
+    auto status = runtime.run();
+    canceller.join();
+
+    // asserted on the state reached, as the timing of a loaded machine is not bounded
+    REQUIRE(status == ecl::RunStatus::Cancelled);
+    REQUIRE(runtime.getStatus() == ecl::RunStatus::Cancelled);
+    size_t completed = 0;
+    for (auto& range : runtime.getCompletedRanges()) {
+      completed += std::get<1>(range);
+    }
+    REQUIRE(completed < size);
+  }
+
+  SECTION("a runtime prepared but not run releases its devices")
+  {
+    auto out = make_shared<vector<int>>(1024, 0);
+    ecl::StaticScheduler sched;
+    for (auto reactor : { false, true }) {
+      vector<ecl::Device> devices;
+      devices.emplace_back(ecl::Device(99, 0));
+      devices.emplace_back(ecl::HostDevice(1));
+      ecl::Runtime runtime(move(devices), 1024, 128);
+      runtime.setScheduler(&sched);
+      runtime.setOutBuffer(out);
+      runtime.setKernel("__kernel void k(){}", "k");
+      runtime.setHostKernel([](size_t, size_t) {});
+      runtime.setReactor(reactor);
+      runtime.prepare();
+    } // joined without running
+  }
+
+  SECTION("completed ranges are sorted and merged")
+  {
+    vector<tuple<size_t, size_t>> ranges = { { 256, 128 }, { 0, 128 }, { 128, 128 }, { 512, 64 } };
+    auto merged = mergeRanges(ranges);
+    REQUIRE(merged.size() == 2);
+    REQUIRE(merged[0] == make_tuple<size_t, size_t>(0, 384));
+    REQUIRE(merged[1] == make_tuple<size_t, size_t>(512, 64));
+
+    vector<tuple<size_t, size_t>> inserted;
+    for (auto& range : ranges) {
+      insertRange(inserted, std::get<0>(range), std::get<1>(range));
+    }
+    REQUIRE(inserted == merged);
+    insertRange(inserted, 448, 64); // fills the hole
+    REQUIRE(inserted.size() == 2);
+    insertRange(inserted, 384, 64);
+    REQUIRE(inserted.size() == 1);
+    REQUIRE(inserted[0] == make_tuple<size_t, size_t>(0, 576));
+  }
+}
@@ -1,5 +1,6 @@
 #include "./tests.hpp"
 
+#include <atomic>
 #include <thread>
 
 #include "Semaphore.hpp"
@@ -8,8 +9,9 @@ using namespace std;
 using namespace Catch::Matchers;
 
 std::mutex m;
+template<typename S>
 void
-thread_wait(Semaphore* sem, int* value)
+thread_wait(S* sem, int* value)
 {
   sem->wait(1);
   m.lock();
@@ -17,8 +19,9 @@ thread_wait(Semaphore* sem, int* value)
   m.unlock();
 }
 
+template<typename S>
 void
-thread_sleep_wait(Semaphore* sem, int* value)
+thread_sleep_wait(S* sem, int* value)
 {
   m.lock();
   *value = *value - 1;
@@ -30,8 +33,9 @@ thread_sleep_wait(Semaphore* sem, int* value)
   m.unlock();
 }
 
+template<typename S>
 void
-thread_notify(Semaphore* sem, int* value)
+thread_notify(S* sem, int* value)
 {
   m.lock();
   *value = *value - 1;
@@ -42,8 +46,9 @@ thread_notify(Semaphore* sem, int* value)
   m.unlock();
 }
 
+template<typename S>
 void
-thread_sleep_notify(Semaphore* sem, int* value)
+thread_sleep_notify(S* sem, int* value)
 {
   m.lock();
   *value = *value - 1;
@@ -55,15 +60,17 @@ thread_sleep_notify(Semaphore* sem, int* value)
   m.unlock();
 }
 
-TEST_CASE("Semaphore", "[Semaphore]")
+template<typename S>
+static void
+semaphoreCases()
 {
 
   SECTION("Semaphore(1) wait(1) waits for notify(1) (until is notified)")
   {
-    Semaphore sem(1);
+    S sem(1);
 
     int value = 0;
-    thread t1(thread_wait, &sem, &value);
+    thread t1(thread_wait<S>, &sem, &value);
     this_thread::sleep_for(50ms);
     m.lock();
     REQUIRE(value == 0);
@@ -78,10 +85,10 @@ TEST_CASE("Semaphore", "[Semaphore]")
 
   SECTION("Semaphore(1) notify(1) before wait(1) does the notification correctly")
   {
-    Semaphore sem(1);
+    S sem(1);
 
     int value = 1;
-    thread t1(thread_sleep_wait, &sem, &value);
+    thread t1(thread_sleep_wait<S>, &sem, &value);
     this_thread::sleep_for(50ms);
     m.lock();
     REQUIRE(value == 0);
@@ -96,11 +103,11 @@ TEST_CASE("Semaphore", "[Semaphore]")
 
   SECTION("Semaphore(2) wait(2) waits for 2 notify(1) (barrier type)")
   {
-    Semaphore sem(2);
+    S sem(2);
 
     int value = 2;
-    thread t1(thread_sleep_notify, &sem, &value);
-    thread t2(thread_sleep_notify, &sem, &value);
+    thread t1(thread_sleep_notify<S>, &sem, &value);
+    thread t2(thread_sleep_notify<S>, &sem, &value);
     this_thread::sleep_for(50ms);
     m.lock();
     REQUIRE(value == 0);
@@ -116,11 +123,11 @@ TEST_CASE("Semaphore", "[Semaphore]")
 
   SECTION("Semaphore(2) wait(2) waits for 2 notify(1) (barrier type, one after other)")
   {
-    Semaphore sem(2);
+    S sem(2);
 
     int value = 2;
-    thread t1(thread_notify, &sem, &value);
-    thread t2(thread_sleep_notify, &sem, &value);
+    thread t1(thread_notify<S>, &sem, &value);
+    thread t2(thread_sleep_notify<S>, &sem, &value);
     this_thread::sleep_for(50ms);
     m.lock();
     REQUIRE(value == 1);
@@ -136,11 +143,11 @@ TEST_CASE("Semaphore", "[Semaphore]")
 
   SECTION("Semaphore(1) with 2 wait(1) and 2 notify(1) each notify releases one wait")
   {
-    Semaphore sem(1);
+    S sem(1);
 
     int value = 2;
-    thread t1(thread_sleep_wait, &sem, &value);
-    thread t2(thread_sleep_wait, &sem, &value);
+    thread t1(thread_sleep_wait<S>, &sem, &value);
+    thread t2(thread_sleep_wait<S>, &sem, &value);
     this_thread::sleep_for(50ms);
     m.lock();
     REQUIRE(value == 0);
@@ -161,11 +168,11 @@ TEST_CASE("Semaphore", "[Semaphore]")
 
   SECTION("Semaphore(1) with 1 wait(1) and 1 notify(2) releases both waits")
   {
-    Semaphore sem(1);
+    S sem(1);
 
     int value = 2;
-    thread t1(thread_sleep_wait, &sem, &value);
-    thread t2(thread_sleep_wait, &sem, &value);
+    thread t1(thread_sleep_wait<S>, &sem, &value);
+    thread t2(thread_sleep_wait<S>, &sem, &value);
     this_thread::sleep_for(50ms);
     m.lock();
     REQUIRE(value == 0);
@@ -181,13 +188,13 @@ TEST_CASE("Semaphore", "[Semaphore]")
 
   SECTION("Semaphore(1) with 1 wait(1) and 1 notify(2) releases both waits (mixing)")
   {
-    Semaphore sem(1);
+    S sem(1);
 
     int value = 4;
-    thread t1(thread_wait, &sem, &value);
-    thread t2(thread_wait, &sem, &value);
-    thread t3(thread_sleep_wait, &sem, &value);
-    thread t4(thread_sleep_wait, &sem, &value);
+    thread t1(thread_wait<S>, &sem, &value);
+    thread t2(thread_wait<S>, &sem, &value);
+    thread t3(thread_sleep_wait<S>, &sem, &value);
+    thread t4(thread_sleep_wait<S>, &sem, &value);
     this_thread::sleep_for(50ms);
     m.lock();
     REQUIRE(value == 2);
@@ -208,4 +215,87 @@ TEST_CASE("Semaphore", "[Semaphore]")
     t3.join();
     t4.join();
   }
+
+  SECTION("Semaphore(2) wait_for(2) times out until both notify(1) (barrier with timeout)")
+  {
+    S sem(2);
+
+    int value = 1;
+    sem.notify(1);
+    REQUIRE_FALSE(sem.wait_for(50ms, 2));
+    thread t1(thread_sleep_notify<S>, &sem, &value);
+    REQUIRE(sem.wait_until(chrono::steady_clock::now() + 1s, 2));
+    t1.join();
+  }
+}
+
+TEST_CASE("Semaphore", "[Semaphore]")
+{
+  semaphoreCases<basic_semaphore<std::mutex, std::condition_variable>>();
+}
+
+#if ECL_FUTEX_SEMAPHORE
+TEST_CASE("FutexSemaphore", "[Semaphore]")
+{
+  semaphoreCases<basic_semaphore<futex, futex>>();
+
+  SECTION("no notification is lost by concurrent producers")
+  {
+    basic_semaphore<futex, futex> sem(1);
+    const int producers = 4;
+    const int notifies = 20000;
+    vector<thread> threads;
+    for (int p = 0; p < producers; ++p) {
+      threads.emplace_back([&] {
+        for (int i = 0; i < notifies; ++i) {
+          sem.notify(1);
+        }
+      });
+    }
+    auto received = 0;
+    while (received < producers * notifies && sem.wait_for(1s)) {
+      received++;
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    REQUIRE(received == producers * notifies);
+    REQUIRE_FALSE(sem.wait_for(0ns));
+  }
+}
+#endif
+
+//! \brief Round trips between two threads (notify, then wait for the answer).
+template<typename S>
+static double
+pingPongNs(int rounds)
+{
+  S ping(1);
+  S pong(1);
+  thread t([&] {
+    for (int i = 0; i < rounds; ++i) {
+      ping.wait(1);
+      pong.notify(1);
+    }
+  });
+  auto t1 = chrono::steady_clock::now();
+  for (int i = 0; i < rounds; ++i) {
+    ping.notify(1);
+    pong.wait(1);
+  }
+  auto t2 = chrono::steady_clock::now();
+  t.join();
+  return chrono::duration_cast<chrono::nanoseconds>(t2 - t1).count() / static_cast<double>(rounds);
+}
+
+// ./test-EngineCL "[benchmark]"
+TEST_CASE("Semaphore round trip", "[.][benchmark]")
+{
+  const int rounds = 100000;
+  auto mutexNs = pingPongNs<basic_semaphore<std::mutex, std::condition_variable>>(rounds);
+  cout << "mutex + condition_variable: " << mutexNs << " ns per round trip\n";
+#if ECL_FUTEX_SEMAPHORE
+  auto futexNs = pingPongNs<basic_semaphore<futex, futex>>(rounds);
+  cout << "futex: " << futexNs << " ns per round trip\n";
+#endif
 }
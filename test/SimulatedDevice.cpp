@@ -0,0 +1,109 @@
+#include "./tests.hpp"
+
+#include "EngineCL.hpp"
+
+using namespace std;
+
+TEST_CASE("SimulatedDevice", "[SimulatedDevice]")
+{
+  // 1e6 and 3e6 items/s, 10 us of launch and no transfers (as in the Simulator tests)
+  ecl::DeviceModel slow{ "slow", 1e6, 10e-6, 0, 0.0, 0.0, 0.0, 0.0 };
+  ecl::DeviceModel fast{ "fast", 3e6, 10e-6, 0, 0.0, 0.0, 0.0, 0.0 };
+  size_t size = 1 << 15;
+  auto out = make_shared<vector<int>>(size, 0);
+
+  SECTION("chunks take the time of the model, without kernels")
+  {
+    ecl::StaticScheduler sched;
+    vector<ecl::Device> devices;
+    devices.emplace_back(ecl::SimulatedDevice(slow));
+    devices.emplace_back(ecl::SimulatedDevice(fast, true));
+    ecl::Runtime runtime(move(devices), size, 128);
+    runtime.setScheduler(&sched);
+    sched.setRawProportions({ 0.25 });
+    runtime.setOutBuffer(out);
+    runtime.setProfiling(true);
+    runtime.run();
+
+    auto stats = runtime.stats();
+    REQUIRE(stats.devices[0].simulated);
+    REQUIRE(stats.devices[0].worksSize == size / 4);
+    REQUIRE(stats.devices[1].worksSize == size * 3 / 4);
+    for (auto& device : stats.devices) { // both 8.2 ms of kernel
+      REQUIRE(device.kernel_ns == 8192000);
+      REQUIRE(device.chunks.size() == 1);
+      REQUIRE(device.chunks[0].duration_ns >= 8192000 + 10000);
+      REQUIRE(device.chunks[0].kernel_ns == 8192000);
+    }
+    REQUIRE(stats.toJson().find("\"simulated\":true") != string::npos);
+    REQUIRE(runtime.getCompletedRanges() ==
+            vector<tuple<size_t, size_t>>({ make_tuple(size_t(0), size) }));
+  }
+
+  SECTION("the dynamic scheduler follows the speed ratio of the models")
+  {
+    ecl::DynamicScheduler sched;
+    vector<ecl::Device> devices;
+    devices.emplace_back(ecl::SimulatedDevice(slow));
+    devices.emplace_back(ecl::SimulatedDevice(fast));
+    ecl::Runtime runtime(move(devices), size, 128);
+    runtime.setScheduler(&sched);
+    sched.setChunks(64);
+    runtime.setOutBuffer(out);
+    runtime.run();
+
+    auto stats = runtime.stats();
+    REQUIRE(stats.scheduler.chunks == 64);
+    // 3x faster, less what the pipelined chunks and the sleeps of a loaded host blur
+    REQUIRE(stats.devices[1].worksSize > 3 * stats.devices[0].worksSize / 2);
+    REQUIRE(stats.devices[0].worksSize + stats.devices[1].worksSize == size);
+  }
+
+  SECTION("the time overslept is taken from the next chunks")
+  {
+    ecl::DynamicScheduler sched;
+    vector<ecl::Device> devices;
+    devices.emplace_back(ecl::SimulatedDevice({ "tiny", 1e7, 0.0, 0, 0.0, 0.0, 0.0, 0.0 }));
+    ecl::Runtime runtime(move(devices), size, 128);
+    runtime.setScheduler(&sched);
+    sched.setChunks(size / 128); // 12.8 us each, 3.3 ms in all
+    runtime.setOutBuffer(out);
+    runtime.run();
+
+    size_t busy = 0;
+    for (auto& chunk : runtime.stats().devices[0].chunks) {
+      busy += chunk.duration_ns;
+    }
+    REQUIRE(busy < 2 * 3276800);
+  }
+
+  SECTION("calibration probes the model without waiting")
+  {
+    auto gpu = fast;
+    gpu.writeBytes = 1 << 20;
+    gpu.writeBandwidth = 8e9;
+    gpu.readBytesPerItem = 4.0;
+    gpu.readBandwidth = 4e9;
+    vector<ecl::Device> devices;
+    devices.emplace_back(ecl::SimulatedDevice(slow));
+    devices.emplace_back(ecl::SimulatedDevice(gpu));
+    ecl::StaticScheduler sched;
+    ecl::Runtime runtime(move(devices), size, 128);
+    runtime.setScheduler(&sched);
+    runtime.setOutBuffer(out);
+    auto calibration = runtime.calibrate(size);
+
+    auto model = ecl::DeviceModel::fromProfile(calibration.profiles[1]);
+    REQUIRE(model.itemsPerSecond == Approx(gpu.itemsPerSecond));
+    REQUIRE(model.writeBandwidth == Approx(gpu.writeBandwidth));
+    REQUIRE(model.readBytesPerItem == Approx(gpu.readBytesPerItem));
+    REQUIRE(calibration.proportions[0] == Approx(0.25).epsilon(0.05));
+  }
+
+  SECTION("a model requires a throughput")
+  {
+    auto stopped = slow;
+    stopped.itemsPerSecond = 0.0;
+    REQUIRE_THROWS_WITH(ecl::SimulatedDevice(stopped), Catch::Contains("requires a throughput"));
+  }
+}
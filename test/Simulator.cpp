@@ -0,0 +1,107 @@
+#include "./tests.hpp"
+
+#include "EngineCL.hpp"
+
+using namespace std;
+
+TEST_CASE("Simulator", "[Simulator]")
+{
+  // 1e6 and 3e6 items/s, 10 us of launch and no transfers
+  ecl::DeviceModel slow{ "slow", 1e6, 10e-6, 0, 0.0, 0.0, 0.0, 0.0 };
+  ecl::DeviceModel fast{ "fast", 3e6, 10e-6, 0, 0.0, 0.0, 0.0, 0.0 };
+  size_t size = 1 << 16;
+
+  SECTION("a static split runs in virtual time")
+  {
+    ecl::Simulator sim({ slow, slow }, size, 128);
+    ecl::StaticScheduler sched;
+    sim.setScheduler(&sched);
+    auto stats = sim.run();
+
+    REQUIRE(stats.devices.size() == 2);
+    REQUIRE(stats.devices[0].works == 1);
+    REQUIRE(stats.devices[1].worksSize == size / 2);
+    REQUIRE(stats.balance.makespan_ns == 10000 + size / 2 * 1000);
+    REQUIRE(stats.balance.efficiency == Approx(1.0));
+    REQUIRE(stats.balance.baseline_ns == 10000 + size * 1000);
+    REQUIRE(stats.scheduler.dispatches.size() == 2);
+    REQUIRE(stats.scheduler.dispatches[1].ts_ns == 0);
+    REQUIRE(stats.completed.size() == 1);
+    REQUIRE(std::get<1>(stats.completed[0]) == size);
+  }
+
+  SECTION("the dynamic scheduler balances heterogeneous devices")
+  {
+    ecl::Simulator sim({ slow, fast }, size, 128);
+    ecl::StaticScheduler even;
+    sim.setScheduler(&even);
+    auto evenStats = sim.run();
+    REQUIRE(evenStats.balance.efficiency == Approx(1.0 / 3).epsilon(0.01));
+
+    ecl::DynamicScheduler dynamic;
+    sim.setScheduler(&dynamic);
+    dynamic.setChunks(64);
+    auto stats = sim.run();
+    REQUIRE(stats.scheduler.name == "dynamic");
+    REQUIRE(stats.scheduler.chunks == 64);
+    REQUIRE(stats.devices[1].worksSize > 2 * stats.devices[0].worksSize);
+    REQUIRE(stats.balance.efficiency > 0.9);
+    REQUIRE(stats.balance.makespan_ns < evenStats.balance.makespan_ns);
+    REQUIRE(stats.balance.speedup > 1.2);
+    REQUIRE(stats.completed.size() == 1);
+    REQUIRE(std::get<1>(stats.completed[0]) == size);
+  }
+
+  SECTION("the work slots are reused over thousands of chunks")
+  {
+    ecl::Simulator sim({ slow, fast, fast }, size, 8);
+    ecl::DynamicScheduler dynamic;
+    sim.setScheduler(&dynamic);
+    dynamic.setChunks(size / 8);
+    auto stats = sim.run();
+    REQUIRE(stats.scheduler.chunks == size / 8);
+    REQUIRE(stats.devices[0].works + stats.devices[1].works + stats.devices[2].works == size / 8);
+    REQUIRE(stats.completed.size() == 1);
+    REQUIRE(std::get<1>(stats.completed[0]) == size);
+  }
+
+  SECTION("transfers are modelled and the noise is reproducible")
+  {
+    fast.writeBytes = 1000000;
+    fast.writeBandwidth = 1e9; // 1 ms before its first chunk
+    fast.readBytesPerItem = 4;
+    fast.readBandwidth = 1e9;
+    fast.noise = 0.1;
+    ecl::Simulator sim({ slow, fast }, size, 128);
+    sim.setSeed(7);
+    size_t makespans[2];
+    for (auto& makespan : makespans) {
+      ecl::DynamicScheduler dynamic;
+      sim.setScheduler(&dynamic);
+      dynamic.setChunks(32);
+      auto stats = sim.run();
+      makespan = stats.balance.makespan_ns;
+      REQUIRE(stats.devices[1].chunks[0].ts_ns >= 1000000);
+      REQUIRE(stats.devices[1].readBytes == stats.devices[1].worksSize * 4);
+      REQUIRE(stats.devices[1].read_gbps == Approx(1.0));
+    }
+    REQUIRE(makespans[0] == makespans[1]);
+  }
+
+  SECTION("models are fitted from the chunks of a run")
+  {
+    ecl::DeviceStats device{};
+    device.id = 1;
+    for (size_t chunk = 1; chunk <= 4; ++chunk) { // 2 ns per item and 5 us per chunk
+      device.chunks.push_back({ 0, chunk * 1024, 0, 5000 + 2 * chunk * 1024, 0, 0 });
+    }
+    auto model = ecl::DeviceModel::fit(device);
+    REQUIRE(model.itemsPerSecond == Approx(5e8));
+    REQUIRE(model.launchSeconds == Approx(5e-6));
+    REQUIRE(model.noise == Approx(0.0).margin(1e-9));
+    REQUIRE(model.readBandwidth == 0.0);
+
+    device.chunks.clear();
+    REQUIRE_THROWS_WITH(ecl::DeviceModel::fit(device), Catch::Contains("without chunks"));
+  }
+}
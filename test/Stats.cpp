@@ -0,0 +1,109 @@
+#include "./tests.hpp"
+
+#include "Inspector.hpp"
+#include "Stats.hpp"
+
+using namespace std;
+
+TEST_CASE("Stats", "[Stats]")
+{
+  ecl::Stats stats;
+  stats.kernel = "saxpy";
+  stats.status = "completed";
+  stats.phases = ecl::phasesFromOffsets(
+    { make_tuple(100, ecl::ActionType::initDiscovery), make_tuple(350, ecl::ActionType::init) });
+  ecl::DeviceStats device;
+  device.id = 0;
+  device.platform = 1;
+  device.device = 0;
+  device.quarantined = true;
+  device.failure = "build \"failed\"";
+  device.works = 1;
+  device.worksSize = 512;
+  device.eventsDropped = 0;
+  device.chunks = { { 0, 512, 1000, 2000, 0, 0 } };
+  device.kernel_ns = device.write_ns = device.read_ns = device.overhead_ns = 0;
+  device.writes = 1;
+  device.writeBytes = 4096;
+  device.reads = 1;
+  device.readBytes = 2048;
+  device.write_gbps = 2.0;
+  device.read_gbps = 0.0;
+  device.buffers = { { "in", 0, 4096, 1, 4096, 2048, 2.0 } };
+  stats.devices = { device };
+  stats.scheduler.name = "static";
+  stats.scheduler.chunks = 1;
+  stats.scheduler.dispatches = { { 900, 0, 0, 512 } };
+  stats.completed = { make_tuple<size_t, size_t>(0, 512) };
+
+  SECTION("phases are durations from the previous action")
+  {
+    REQUIRE(stats.phases.size() == 2);
+    REQUIRE(stats.phases[0].name == "initDiscovery");
+    REQUIRE(stats.phases[0].duration_ns == 0);
+    REQUIRE(stats.phases[1].offset_ns == 350);
+    REQUIRE(stats.phases[1].duration_ns == 250);
+  }
+
+  SECTION("json")
+  {
+    auto json = stats.toJson();
+    REQUIRE_THAT(json, Catch::StartsWith("{\"kernel\":\"saxpy\",\"status\":\"completed\""));
+    REQUIRE_THAT(json, Catch::Contains("\"failure\":\"build \\\"failed\\\"\""));
+    REQUIRE_THAT(json, Catch::Contains("\"chunks\":[{\"offset\":0,\"size\":512,\"ts_ns\":1000"));
+    REQUIRE_THAT(json, Catch::Contains("\"recoveries\":[]"));
+    REQUIRE_THAT(json,
+                 Catch::Contains("\"buffers\":[{\"direction\":\"in\",\"index\":0,\"bytes\":4096,"
+                                 "\"transfers\":1,\"transferred_bytes\":4096,"
+                                 "\"transfer_ns\":2048,\"gbps\":2}]"));
+    REQUIRE_THAT(json, Catch::EndsWith("\"completed\":[{\"offset\":0,\"size\":512}]}"));
+  }
+
+  SECTION("csv")
+  {
+    auto csv = stats.toCsv();
+    REQUIRE_THAT(csv, Catch::StartsWith("thread,kind,name,offset,size,ts_ns,duration_ns\n"));
+    REQUIRE_THAT(csv, Catch::Contains("runtime,phase,init,,,350,250\n"));
+    REQUIRE_THAT(csv, Catch::Contains("scheduler,dispatch,0,0,512,900,\n"));
+    REQUIRE_THAT(csv, Catch::Contains("0,chunk,,0,512,1000,2000\n"));
+  }
+
+  SECTION("balance of two devices")
+  {
+    ecl::DeviceStats slow = device;
+    slow.id = 1;
+    slow.chunks = { { 0, 256, 1000, 1000, 0, 0 }, { 256, 256, 3000, 3000, 0, 0 } };
+    ecl::DeviceStats fast = device;
+    fast.chunks = { { 512, 512, 1000, 2000, 0, 0 } };
+    stats.devices = { fast, slow };
+    ecl::computeBalance(stats, 0);
+
+    REQUIRE(stats.balance.makespan_ns == 5000);
+    REQUIRE(stats.devices[1].busy_ns == 4000);
+    REQUIRE(stats.devices[1].idle_ns == 1000);
+    REQUIRE(stats.devices[0].finish_ns == 2000);
+    REQUIRE(stats.devices[0].lag_ns == 3000);
+    REQUIRE(stats.balance.efficiency == Approx(0.4));
+    // fast alone: 2000 ns for half the items
+    REQUIRE(stats.balance.baseline_ns == 4000);
+    REQUIRE(stats.balance.speedup == Approx(0.8));
+
+    ecl::computeBalance(stats, 10000);
+    REQUIRE_FALSE(stats.balance.baselineMeasured);
+    REQUIRE(stats.balance.speedup == Approx(2.0));
+  }
+
+  SECTION("latency percentiles")
+  {
+    vector<size_t> samples;
+    for (size_t i = 100; i > 0; --i) {
+      samples.push_back(i * 1000);
+    }
+    auto latency = ecl::latencyStats("gap", samples);
+    REQUIRE(latency.samples == 100);
+    REQUIRE(latency.p50_ns == 50000);
+    REQUIRE(latency.p99_ns == 99000);
+    REQUIRE(latency.max_ns == 100000);
+    REQUIRE(ecl::latencyStats("gap", {}).max_ns == 0);
+  }
+}
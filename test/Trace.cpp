@@ -0,0 +1,42 @@
+#include "./tests.hpp"
+
+#include <sstream>
+
+#include "Trace.hpp"
+
+using namespace std;
+
+TEST_CASE("Trace", "[Trace]")
+{
+  SECTION("events are written in the Chrome Trace Event format (microseconds)")
+  {
+    ecl::Trace trace;
+    trace.setTrackName(2, "device 0");
+    trace.addSpan(2, "chunk", "chunk", 1500, 2000250, "\"offset\":0");
+    trace.addInstant(1, "dispatch", "scheduler", 999);
+
+    ostringstream os;
+    trace.write(os);
+    auto json = os.str();
+    REQUIRE_THAT(json, Catch::StartsWith("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+    REQUIRE_THAT(json, Catch::Contains("\"name\":\"thread_name\",\"args\":{\"name\":\"device 0\"}"));
+    REQUIRE_THAT(json, Catch::Contains("\"ts\":1.500,\"dur\":2000.250,\"args\":{\"offset\":0}"));
+    REQUIRE_THAT(json, Catch::Contains("\"ph\":\"i\",\"s\":\"t\",\"pid\":0,\"tid\":1"));
+    REQUIRE_THAT(json, Catch::Contains("\"ts\":0.999,\"args\":{}}\n]}"));
+  }
+
+  SECTION("names and categories are escaped")
+  {
+    ecl::Trace trace;
+    trace.setTrackName(0, "a \"quoted\" track");
+    trace.addSpan(0, "back\\slash", "cat\"egory", 0, 1);
+    trace.addInstant(0, "new\nline", "phase", 0);
+
+    ostringstream os;
+    trace.write(os);
+    auto json = os.str();
+    REQUIRE_THAT(json, Catch::Contains("{\"name\":\"a \\\"quoted\\\" track\"}"));
+    REQUIRE_THAT(json, Catch::Contains("\"name\":\"back\\\\slash\",\"cat\":\"cat\\\"egory\""));
+    REQUIRE_THAT(json, Catch::Contains("\"name\":\"new\\nline\",\"cat\":\"phase\""));
+  }
+}